@@ -7,11 +7,15 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        fd44editor.cpp
+        fd44editor.cpp\
+        imagejob.cpp\
+        imagelistmodel.cpp
 
-HEADERS  += fd44editor.h \
-    bios.h \
-    motherboards.h
+HEADERS  += fd44editor.h\
+        imagejob.h\
+        imagelistmodel.h
+
+include(fd44core.pri)
 
 FORMS    += fd44editor.ui
 
@@ -0,0 +1,340 @@
+/* fd44bench.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Parser benchmark suite.
+// Times signature search engines, full parse, indexed parse, full write, every parsing stage
+// and output file creation on synthetic 6 series images of 4 to 64 MB built by ImageGenerator.
+// Results are printed as JSON, so runs can be compared by scripts.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "fd44parser.h"
+#include "imagegenerator.h"
+#include "imagewriter.h"
+#include "parsecache.h"
+#include "scanner.h"
+
+#define DEFAULT_RUNS    25
+#define MODULE_SIZE     0x10000
+
+// Counts C++ heap allocations, libfd44 allocates through operator new only
+static unsigned long long allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    operator delete[](p);
+}
+
+static const char *COPY_METHOD_NAMES[] = {"clone", "kernel", "readwrite"};
+
+static const char *STAGE_NAMES[ReadStageCount] = {"scan", "bootefi", "me", "gbe", "module", "ascii_mac",
+                                                  "short_dts", "long_dts", "uuid", "mbsn"};
+
+// 6 series image with ASCII MAC, long DTS key, UUID and MBSN at the end of pseudo-random module body,
+// so every body search walks the whole module
+static QByteArray syntheticImage(int size)
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = size;
+    options.me = Me5M;
+    options.module_size = MODULE_SIZE;
+    options.module_padding = MODULE_SIZE - 0x200;
+    return ImageGenerator::generate(options);
+}
+
+// Nearest-rank percentile
+static qint64 percentile(std::vector<qint64> times, double p)
+{
+    std::sort(times.begin(), times.end());
+    size_t rank = (size_t)ceil(p * times.size());
+    return times[rank > 0 ? rank - 1 : 0];
+}
+
+class Report
+{
+public:
+    Report(QTextStream & out) : out(out), first(true) {}
+
+    // Negative allocation count is omitted, it is not known for stages
+    void add(const QString & benchmark, int size, const std::vector<qint64> & times, double allocations)
+    {
+        qint64 p50 = percentile(times, 0.5);
+        out << (first ? "\n" : ",\n");
+        out << QString("    {\"benchmark\": \"%1\", \"image_size\": %2, \"bytes_per_sec\": %3, ")
+               .arg(benchmark).arg(size).arg(p50 > 0 ? size * 1e9 / p50 : 0.0, 0, 'f', 0);
+        if (allocations >= 0)
+            out << QString("\"allocs_per_op\": %1, ").arg(allocations, 0, 'f', 1);
+        out << QString("\"p50_ns\": %1, \"p99_ns\": %2}").arg(p50).arg(percentile(times, 0.99));
+        first = false;
+    }
+
+private:
+    QTextStream & out;
+    bool first;
+};
+
+static void benchScan(Report & report, const QByteArray & image, int runs)
+{
+    QList<QByteArray> signatures;
+    signatures << toByteArray(BOOTEFI_HEADER) << toByteArray(ME_HEADER) << toByteArray(ME_3M_SIGN)
+               << toByteArray(ME_5M_SIGN) << toByteArray(ME_VERSION_HEADER) << toByteArray(GBE_HEADER)
+               << toByteArray(MODULE_HEADER);
+
+    SignatureScanner scanner;
+    for (int i = 0; i < signatures.size(); i++)
+        scanner.addSignature(signatures.at(i).constData(), signatures.at(i).length());
+    scanner.build();
+
+    // One indexOf sweep per signature, as parser did before
+    std::vector<qint64> times;
+    unsigned long long allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < signatures.size(); i++)
+            for (int pos = image.indexOf(signatures.at(i)); pos != -1; pos = image.indexOf(signatures.at(i), pos + 1))
+                ;
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add("scan/indexOf", image.size(), times, (double)(allocationCount - allocations) / runs);
+
+    // Single pass engines
+    const SignatureScanner::engine_e engines[] = {SignatureScanner::AutomatonEngine, SignatureScanner::DefaultEngine};
+    const char *names[] = {"scan/automaton", "scan/default"};
+    for (int e = 0; e < 2; e++)
+    {
+        times.clear();
+        allocations = allocationCount;
+        for (int run = 0; run < runs; run++)
+        {
+            std::vector<hits_t> hits;
+            QElapsedTimer timer;
+            timer.start();
+            scanner.scan(image.constData(), image.size(), hits, engines[e]);
+            times.push_back(timer.nsecsElapsed());
+        }
+        report.add(names[e], image.size(), times, (double)(allocationCount - allocations) / runs);
+    }
+}
+
+static bool benchParser(Report & report, const QByteArray & image, int runs)
+{
+    ByteView view(image.constData(), image.size());
+    bios_t bios;
+
+    // Full parse without profiling overhead
+    std::vector<qint64> times;
+    unsigned long long allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        FD44Image::read(view, bios);
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add("read", image.size(), times, (double)(allocationCount - allocations) / runs);
+    if (bios.state != Valid)
+        return false;
+
+    // Parse of image of known build, offsets are checked instead of scanning
+    ParseCache cache;
+    image_offsets_t offsets;
+    FD44Image::scan(view, offsets);
+    cache.addBuild(view, offsets);
+    times.clear();
+    allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (!cache.findBuild(view, offsets))
+            return false;
+        FD44Image::read(view, offsets, bios);
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add("read/indexed", image.size(), times, (double)(allocationCount - allocations) / runs);
+
+    // Separate stages
+    std::vector<qint64> stageTimes[ReadStageCount];
+    for (int run = 0; run < runs; run++)
+    {
+        read_profile_t profile;
+        FD44Image::read(view, bios, &profile);
+        for (int stage = 0; stage < ReadStageCount; stage++)
+            stageTimes[stage].push_back(profile.nsecs[stage]);
+    }
+    for (int stage = 0; stage < ReadStageCount; stage++)
+        report.add(QString("read/%1").arg(STAGE_NAMES[stage]), image.size(), stageTimes[stage], -1);
+
+    // Full write of changed MAC to a copy, as done in place by ImageWriter::patch
+    FD44Image::setField(bios, MacField, ByteView("\xDE\xAD\xBE\xEF\x00\x01", MAC_LENGTH));
+    QByteArray output(image.constData(), image.size());
+    std::vector<image_patch_t> patches;
+    times.clear();
+    allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (FD44Image::buildPatches(view, bios, patches).error != NoError)
+            return false;
+        FD44Image::applyPatches(output.data(), output.size(), patches);
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add("write", image.size(), times, (double)(allocationCount - allocations) / runs);
+    return true;
+}
+
+// Personalized image output: whole image write against copy of template file with changed
+// ranges written into it. Copy method depends on filesystem of directory and is added to name.
+static bool benchOutput(Report & report, const QByteArray & image, const QString & directory, int runs)
+{
+    QString source = QDir(directory).filePath("fd44bench-template.rom");
+    QString output = QDir(directory).filePath("fd44bench-output.rom");
+    if (!ImageWriter::write(source, image))
+        return false;
+
+    bios_t bios;
+    QList<patch_t> patches;
+    FD44Parser::readFromBIOS(image, bios);
+    FD44Parser::setField(bios, MacField, QByteArray("\xDE\xAD\xBE\xEF\x00\x02", MAC_LENGTH));
+    if (FD44Parser::buildPatches(image, bios, patches).error != NoError)
+        return false;
+    QByteArray newImage = FD44Parser::applyPatches(image, patches);
+
+    std::vector<qint64> times;
+    unsigned long long allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (!ImageWriter::write(output, newImage))
+            return false;
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add("output/write", image.size(), times, (double)(allocationCount - allocations) / runs);
+
+    copy_method_e method = ReadWriteCopy;
+    times.clear();
+    allocations = allocationCount;
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (!ImageWriter::copy(source, output, patches, 0, -1, &method))
+            return false;
+        times.push_back(timer.nsecsElapsed());
+    }
+    report.add(QString("output/copy/%1").arg(COPY_METHOD_NAMES[method]), image.size(), times,
+               (double)(allocationCount - allocations) / runs);
+
+    QFile::remove(source);
+    QFile::remove(output);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int runs = DEFAULT_RUNS;
+    QString directory = QDir::tempPath();
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i += 2)
+    {
+        ok = (i + 1 < argc);
+        if (ok && !strcmp(argv[i], "-n"))
+            runs = atoi(argv[i + 1]);
+        else if (ok && !strcmp(argv[i], "-d"))
+            directory = QString::fromLocal8Bit(argv[i + 1]);
+        else
+            ok = false;
+    }
+    if (!ok || runs <= 0)
+    {
+        fprintf(stderr, "Usage: fd44bench [-n <runs>] [-d <directory>]\n"
+                        "Output files are written to directory, system temporary directory by default.\n");
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << "{\n";
+    out << QString("  \"engine\": \"%1\",\n").arg(SignatureScanner::defaultEngineName());
+    out << QString("  \"runs\": %1,\n").arg(runs);
+    out << "  \"results\": [";
+
+    Report report(out);
+    for (int megabytes = 4; megabytes <= 64; megabytes *= 2)
+    {
+        QByteArray image = syntheticImage(megabytes * 1024 * 1024);
+        benchScan(report, image, runs);
+        if (!benchParser(report, image, runs))
+        {
+            out.flush();
+            fprintf(stderr, "\nSynthetic %d MB image is not parsed\n", megabytes);
+            return 1;
+        }
+        if (!benchOutput(report, image, directory, runs))
+        {
+            out.flush();
+            fprintf(stderr, "\nCan't write output files to %s\n", qPrintable(directory));
+            return 1;
+        }
+    }
+
+    out << "\n  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,12 @@
+QT       = core
+
+TARGET = fd44bench
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES += fd44bench.cpp
+
+include(../fd44core.pri)
+include(../gen/imagegenerator.pri)
@@ -0,0 +1,240 @@
+/* batch.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Batch personalization from CSV manifest.
+// Template is parsed and searched once, every output image is a copy of template
+// file made by ImageWriter::copy, so on copy-on-write filesystems it shares
+// template data, and only bytes at found offsets are written into it.
+// In delta mode only delta files against template are written.
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include "common.h"
+
+// Manifest columns, output file name is required, other values are taken from template if missing
+enum manifest_column_e {OutputColumn, MacColumn, UuidColumn, MbsnColumn, DtsColumn, ManifestColumnCount};
+static const char* MANIFEST_COLUMNS[] = {"file", "mac", "uuid", "mbsn", "dts"};
+
+typedef struct {
+    int line;
+    QString values[ManifestColumnCount];
+} manifest_row_t;
+
+// Template and results shared by all workers
+class BatchJob
+{
+public:
+    BatchJob(const QString & source, const ImageFile & file, const bios_t & bios, const patch_layout_t & layout,
+             const QString & directory, bool delta)
+        : source(source), offset(file.offset()), image(file.data()), bios(bios), layout(layout), directory(directory),
+          delta(delta), written(0), exitCode(ExitOk) {}
+
+    const QString source;
+    const int offset;
+    const QByteArray image;
+    const bios_t bios;
+    const patch_layout_t layout;
+    const QDir directory;
+    const bool delta;
+
+    void done(const QString & path)
+    {
+        QMutexLocker locker(&mutex);
+        written++;
+        QTextStream(stdout) << "written=" << path << "\n";
+    }
+
+    void failed(int line, int code, const QString & message)
+    {
+        QMutexLocker locker(&mutex);
+        fail(code, QString("line %1: %2").arg(line).arg(message));
+        exitCode = qMax(exitCode, code);
+    }
+
+    int writtenCount() const { return written; }
+    int result() const { return exitCode; }
+
+private:
+    QMutex mutex;
+    int written;
+    int exitCode;
+};
+
+// Manifest row, capsule header of template is not copied
+class BatchTask : public QRunnable
+{
+public:
+    BatchTask(BatchJob *job, const manifest_row_t & row) : job(job), row(row) {}
+
+    void run()
+    {
+        bios_t bios = job->bios;
+        QString error = setValues(bios, row.values[MacColumn], row.values[UuidColumn],
+                                  row.values[MbsnColumn], row.values[DtsColumn]);
+        if (error.isEmpty())
+            error = missingValue(bios);
+        if (!error.isEmpty())
+        {
+            job->failed(row.line, ExitUsage, error);
+            return;
+        }
+
+        QList<patch_t> patches;
+        image_status_t status = FD44Parser::layoutPatches(job->image, job->layout, bios, patches);
+        if (status.error != NoError)
+        {
+            job->failed(row.line, ExitParseError, FD44Parser::errorString(status, job->image, bios));
+            return;
+        }
+
+        QString path = job->directory.filePath(row.values[OutputColumn]);
+        bool written = job->delta ? writeDelta(path, job->image, patches)
+                                  : ImageWriter::copy(job->source, path, patches, job->offset, job->image.size());
+        if (!written)
+            job->failed(row.line, ExitIoError, QString("can't write %1").arg(path));
+        else
+            job->done(path);
+    }
+
+private:
+    BatchJob *job;
+    manifest_row_t row;
+};
+
+// Reads comma-separated manifest with header line naming columns, values are not quoted
+static QString readManifest(const QString & path, QList<manifest_row_t> & rows)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return QString("can't open %1 for reading").arg(path);
+
+    QTextStream in(&file);
+    int columns[ManifestColumnCount];
+    QHash<QString, int> lines;
+    int line = 0;
+    bool header = true;
+    while (!in.atEnd())
+    {
+        QString text = in.readLine().trimmed();
+        line++;
+        if (text.isEmpty())
+            continue;
+        QStringList fields = text.split(',');
+
+        if (header)
+        {
+            for (int i = 0; i < ManifestColumnCount; i++)
+                columns[i] = fields.indexOf(MANIFEST_COLUMNS[i]);
+            if (columns[OutputColumn] == -1)
+                return QString("%1 has no %2 column").arg(path).arg(MANIFEST_COLUMNS[OutputColumn]);
+            header = false;
+            continue;
+        }
+
+        manifest_row_t row;
+        row.line = line;
+        for (int i = 0; i < ManifestColumnCount; i++)
+            if (columns[i] != -1 && columns[i] < fields.size())
+                row.values[i] = fields.at(columns[i]).trimmed();
+        const QString & name = row.values[OutputColumn];
+        if (name.isEmpty())
+            return QString("line %1: output file name is empty").arg(line);
+        // Output must stay inside output directory
+        if (name == "." || name.contains("..") || name.contains('/') || name.contains('\\') || QDir::isAbsolutePath(name))
+            return QString("line %1: output file name %2 is not a plain file name").arg(line).arg(name);
+        if (lines.contains(name))
+            return QString("line %1: output file name %2 is already used on line %3").arg(line).arg(name).arg(lines.value(name));
+        lines.insert(name, line);
+        rows.append(row);
+    }
+    return QString();
+}
+
+int batch(const QStringList & args)
+{
+    QStringList paths;
+    QString directory;
+    int threads = QThread::idealThreadCount();
+    bool delta = false;
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if (arg == "--delta")
+            delta = true;
+        else if ((arg == "-j" || arg == "-o" || arg == "--output") && i + 1 < args.size())
+        {
+            const QString & value = args.at(++i);
+            if (arg == "-j")
+                threads = value.toInt();
+            else
+                directory = value;
+        }
+        else if (!arg.startsWith('-') && paths.size() < 2)
+            paths.append(arg);
+        else
+            return usage();
+    }
+
+    if (paths.size() != 2 || directory.isEmpty() || threads < 1)
+        return usage();
+
+    QList<manifest_row_t> rows;
+    QString error = readManifest(paths.at(1), rows);
+    if (!error.isEmpty())
+        return fail(ExitUsage, error);
+    if (!QDir().mkpath(directory))
+        return fail(ExitIoError, QString("can't create %1").arg(directory));
+
+    // Template stays mapped, workers only read it
+    ImageFile file;
+    if (!file.open(paths.at(0)))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(paths.at(0)));
+
+    // Workers read template by path, so no output may replace it
+    const QDir outputDirectory(directory);
+    const QString source = QFileInfo(paths.at(0)).canonicalFilePath();
+    for (int i = 0; i < rows.size(); i++)
+        if (QFileInfo(outputDirectory.filePath(rows.at(i).values[OutputColumn])).canonicalFilePath() == source)
+            return fail(ExitUsage, QString("line %1: output file would overwrite template %2").arg(rows.at(i).line).arg(paths.at(0)));
+
+    bios_t bios;
+    image_status_t status = FD44Parser::readFromBIOS(file.data(), bios);
+    if (status.error != NoError)
+        return fail(ExitParseError, FD44Parser::errorString(status, file.data(), bios));
+    setDefaultTypes(bios);
+
+    patch_layout_t layout;
+    status = FD44Parser::buildLayout(file.data(), bios, layout);
+    if (status.error != NoError)
+        return fail(ExitParseError, FD44Parser::errorString(status, file.data(), bios));
+
+    BatchJob job(paths.at(0), file, bios, layout, directory, delta);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < rows.size(); i++)
+        pool.start(new BatchTask(&job, rows.at(i)));
+    pool.waitForDone();
+
+    QTextStream(stdout) << "images=" << job.writtenCount() << "\n";
+    return job.result();
+}
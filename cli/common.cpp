@@ -0,0 +1,172 @@
+/* common.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+
+#include <QFileInfo>
+#include <QTextStream>
+
+#include "common.h"
+
+int fail(int code, const QString & message)
+{
+    QTextStream err(stderr);
+    err << "fd44: " << QString(message).replace('\n', ' ') << "\n";
+    return code;
+}
+
+bool parseHex(const QString & value, int length, QByteArray & result)
+{
+    QString digits = value;
+    digits.remove(':').remove(' ').remove('-');
+    if (digits.length() != length * 2)
+        return false;
+
+    for (int i = 0; i < digits.length(); i++)
+        if (!isxdigit(digits.at(i).toLatin1()))
+            return false;
+
+    result = QByteArray::fromHex(digits.toLatin1());
+    return true;
+}
+
+bool setHexField(bios_t & bios, bios_field_e field, const QString & value, int length)
+{
+    QByteArray bytes;
+    return parseHex(value, length, bytes) && FD44Parser::setField(bios, field, bytes);
+}
+
+void setDefaultTypes(bios_t & bios)
+{
+    if (bios.mac_type == MacNotDetected)
+    {
+        bios.mac_type = UUID;
+        FD44Parser::setField(bios, MacMagicField, QByteArray());
+    }
+    if (bios.dts_type == DtsNotDetected)
+    {
+        bios.dts_type = None;
+        FD44Parser::setField(bios, DtsMagicField, QByteArray());
+    }
+}
+
+QString setValues(bios_t & bios, const QString & mac, const QString & uuid, const QString & mbsn, const QString & dts)
+{
+    if (!mac.isEmpty() && !setHexField(bios, MacField, mac, MAC_LENGTH))
+        return "MAC must be 6 hex bytes";
+    if (!uuid.isEmpty() && !setHexField(bios, UuidField, uuid, UUID_LENGTH - MAC_LENGTH))
+        return "UUID must be 10 hex bytes";
+    if (!dts.isEmpty() && !setHexField(bios, DtsKeyField, dts, DTS_KEY_LENGTH))
+        return "DTS key must be 8 hex bytes";
+    if (!mbsn.isEmpty())
+    {
+        if (mbsn.length() != MBSN_BODY_LENGTH - 1)
+            return "MBSN must be 15 characters long";
+        FD44Parser::setField(bios, MbsnField, mbsn.toLatin1());
+    }
+    return QString();
+}
+
+QString missingValue(const bios_t & bios)
+{
+    // Empty modules have no values at all
+    if (!FD44Parser::hasField(bios, MacField))
+        return "MAC is required";
+    if (bios.mac_type == ASCII && bios.mac_header == Header7Series && !FD44Parser::hasField(bios, MacMagicField))
+        return "MAC magic is required";
+    if (bios.uuid_header != NoHeader && !FD44Parser::hasField(bios, UuidField))
+        return "UUID is required";
+    if (bios.mbsn_header != NoHeader && FD44Parser::field(bios, MbsnField).length() != MBSN_BODY_LENGTH - 1)
+        return "MBSN is required";
+    if ((bios.dts_type == Short || bios.dts_type == Long) && !FD44Parser::hasField(bios, DtsKeyField))
+        return "DTS key is required";
+    if (bios.dts_type == Long && !FD44Parser::hasField(bios, DtsMagicField))
+        return "DTS key magic is required";
+    return QString();
+}
+
+bool readImage(const QString & path, ImageCache *cache, bios_t & bios, image_status_t & status)
+{
+    if (cache)
+        return cache->read(path, bios, status);
+
+    ImageFile image;
+    if (!image.open(path))
+        return false;
+    status = FD44Parser::readFromBIOS(image.data(), bios);
+    return true;
+}
+
+// Same file under any path, through links and relative paths
+static bool isSameFile(const QString & path, const QString & other)
+{
+    QFileInfo info(path), otherInfo(other);
+    return info.exists() && otherInfo.exists() && info.canonicalFilePath() == otherInfo.canonicalFilePath();
+}
+
+bool writeImage(ImageFile & image, const QString & path, const QString & output, const QList<patch_t> & patches)
+{
+    // Output can be the same file, so it is unmapped before writing
+    int offset = image.offset(), size = image.data().size();
+    image.close();
+
+    // Only changed ranges are written in place, capsule header is removed
+    // by copying, new file shares unchanged data with input where filesystem allows
+    if (offset == 0 && isSameFile(path, output))
+        return ImageWriter::patch(output, patches);
+    return ImageWriter::copy(path, output, patches, offset, size);
+}
+
+QStringList recordKeys()
+{
+    return QStringList() << "state" << "motherboard" << "recovery_name" << "bios_version" << "bios_date"
+                         << "me_version" << "me_type" << "gbe_version" << "module_version"
+                         << "mac_type" << "mac" << "mac_magic" << "dts_type" << "dts_key"
+                         << "uuid" << "mbsn" << "error";
+}
+
+QStringList recordValues(const bios_t & bios, const QString & error)
+{
+    static const char* states[] = {"error", "empty", "valid", "incomplete"};
+    static const char* macTypes[] = {"uuid", "ascii", "gbe", "unknown"};
+    static const char* dtsTypes[] = {"none", "short", "long", "unknown"};
+
+    // Most fields are not set when parsing fails
+    if (bios.state == ParseError)
+    {
+        QStringList values;
+        values << states[ParseError];
+        while (values.size() < recordKeys().size() - 1)
+            values << QString();
+        return values << QString(error).replace('\n', ' ');
+    }
+
+    return QStringList() << states[bios.state]
+                         << FD44Parser::fieldText(FD44Parser::field(bios, MotherboardNameField))
+                         << FD44Parser::fieldText(FD44Parser::field(bios, RecoveryNameField))
+                         << FD44Parser::biosVersionString(bios)
+                         << FD44Parser::fieldText(FD44Parser::field(bios, BiosDateField))
+                         << FD44Parser::meVersionString(bios)
+                         << (!FD44Parser::hasField(bios, MeVersionField) ? QString() : FD44Parser::meTypeString(bios))
+                         << FD44Parser::gbeVersionString(bios)
+                         << FD44Parser::fieldHex(FD44Parser::field(bios, ModuleVersionField))
+                         << macTypes[bios.mac_type]
+                         << FD44Parser::fieldHex(FD44Parser::field(bios, MacField))
+                         << FD44Parser::fieldHex(FD44Parser::field(bios, MacMagicField))
+                         << dtsTypes[bios.dts_type]
+                         << (bios.dts_type == Short || bios.dts_type == Long ? FD44Parser::fieldHex(FD44Parser::field(bios, DtsKeyField)) : QString())
+                         << FD44Parser::fieldHex(FD44Parser::field(bios, UuidField))
+                         << FD44Parser::fieldText(FD44Parser::field(bios, MbsnField))
+                         << QString();
+}
@@ -0,0 +1,67 @@
+/* common.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "fd44parser.h"
+#include "imagecache.h"
+#include "imagefile.h"
+#include "imagewriter.h"
+
+enum exit_e {ExitOk, ExitUsage, ExitIoError, ExitParseError, ExitDuplicates};
+
+// Commands
+int usage();
+int scan(const QStringList & args);
+int batch(const QStringList & args);
+int apply(const QStringList & args);
+int verify(const QStringList & args);
+int dupes(const QStringList & args);
+
+// Prints error message to stderr and returns exit code
+int fail(int code, const QString & message);
+
+// Field conversions
+bool parseHex(const QString & value, int length, QByteArray & result);
+bool setHexField(bios_t & bios, bios_field_e field, const QString & value, int length);
+
+// Same defaults as in GUI for values that can't be detected
+void setDefaultTypes(bios_t & bios);
+
+// New field values, empty ones are left unchanged.
+// Both return error message or empty string, missingValue checks
+// that all values required by module layout are set.
+QString setValues(bios_t & bios, const QString & mac, const QString & uuid, const QString & mbsn, const QString & dts);
+QString missingValue(const bios_t & bios);
+
+// Parses image file, through cache if it is set,
+// returns false if file can't be opened
+bool readImage(const QString & path, ImageCache *cache, bios_t & bios, image_status_t & status);
+
+// Writes patches of opened image from path to output and closes it,
+// output is patched in place if it is the same file
+bool writeImage(ImageFile & image, const QString & path, const QString & output, const QList<patch_t> & patches);
+
+// Writes delta file for patches of image data
+bool writeDelta(const QString & path, const QByteArray & image, const QList<patch_t> & patches);
+
+// Parsed image record, same keys are used by all commands
+QStringList recordKeys();
+QStringList recordValues(const bios_t & bios, const QString & error);
+
+#endif // COMMON_H
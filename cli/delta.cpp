@@ -0,0 +1,170 @@
+/* delta.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Delta files: patches of personalized image against its base image.
+// Flashing stations keep base images and receive only deltas,
+// which are checked against base by hash before being applied.
+
+#include <QFile>
+#include <QTextStream>
+
+#include "common.h"
+#include "delta.h"
+
+static ByteView view(const QByteArray & data)
+{
+    return ByteView(data.constData(), data.size());
+}
+
+static QString hexHash(const uint8_t hash[SHA256_LENGTH])
+{
+    return FD44Parser::fieldHex(QByteArray((const char*)hash, SHA256_LENGTH));
+}
+
+bool writeDelta(const QString & path, const QByteArray & image, const QList<patch_t> & patches)
+{
+    std::vector<image_patch_t> imagePatches(patches.size());
+    for (int i = 0; i < patches.size(); i++)
+    {
+        imagePatches[i].offset = patches.at(i).offset;
+        imagePatches[i].data.assign(patches.at(i).data.constData(), patches.at(i).data.constData() + patches.at(i).data.size());
+    }
+
+    image_delta_t delta;
+    std::vector<uint8_t> data;
+    ImageDelta::build(view(image), imagePatches, delta);
+    ImageDelta::write(delta, data);
+    return ImageWriter::write(path, QByteArray((const char*)data.data(), (int)data.size()));
+}
+
+static int readDelta(const QString & path, image_delta_t & delta)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(path));
+    if (!ImageDelta::read(view(file.readAll()), delta))
+        return fail(ExitParseError, QString("%1 is not a valid delta file").arg(path));
+    return ExitOk;
+}
+
+// Explains why image is not delta base
+static QString mismatchString(const ByteView & image, const image_delta_t & delta)
+{
+    if (image.size() != delta.base_size)
+        return QString("image size %1 differs from delta base size %2").arg(image.size()).arg(delta.base_size);
+
+    int entry = ImageDelta::firstChangedEntry(image, delta);
+    if (entry != -1)
+        return QString("image differs from delta base at 0x%1").arg(QString::number(delta.entries[entry].offset, 16).toUpper());
+    return "image differs from delta base outside of patched ranges";
+}
+
+int apply(const QStringList & args)
+{
+    QString path, deltaPath, output;
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if ((arg == "-o" || arg == "--output") && i + 1 < args.size())
+            output = args.at(++i);
+        else if (!arg.startsWith('-') && path.isEmpty())
+            path = arg;
+        else if (!arg.startsWith('-') && deltaPath.isEmpty())
+            deltaPath = arg;
+        else
+            return usage();
+    }
+
+    if (deltaPath.isEmpty())
+        return usage();
+    if (output.isEmpty())
+        output = path;
+
+    image_delta_t delta;
+    int result = readDelta(deltaPath, delta);
+    if (result != ExitOk)
+        return result;
+
+    ImageFile image;
+    if (!image.open(path))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(path));
+
+    QTextStream out(stdout);
+    const QByteArray bytes = image.data();
+    ByteView data = view(bytes);
+    delta_match_e match = ImageDelta::match(data, delta);
+    if (match == DeltaMismatch)
+        return fail(ExitParseError, mismatchString(data, delta));
+
+    // Applied delta is not written again
+    if (match == DeltaResult && output == path)
+    {
+        out << "unchanged=" << output << "\n";
+        return ExitOk;
+    }
+
+    // Image with delta already applied is copied as is
+    QList<patch_t> patches;
+    if (match == DeltaBase)
+    {
+        for (size_t i = 0; i < delta.entries.size(); i++)
+        {
+            patch_t patch;
+            patch.offset = delta.entries[i].offset;
+            patch.data = QByteArray((const char*)delta.entries[i].data.data(), (int)delta.entries[i].data.size());
+            patches.append(patch);
+        }
+    }
+
+    if (!writeImage(image, path, output, patches))
+        return fail(ExitIoError, QString("can't write %1").arg(output));
+
+    out << "written=" << output << "\n";
+    return ExitOk;
+}
+
+int verify(const QStringList & args)
+{
+    if (args.size() != 2)
+        return usage();
+
+    image_delta_t delta;
+    int result = readDelta(args.at(1), delta);
+    if (result != ExitOk)
+        return result;
+
+    ImageFile image;
+    if (!image.open(args.at(0)))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(args.at(0)));
+
+    QTextStream out(stdout);
+    const QByteArray bytes = image.data();
+    ByteView data = view(bytes);
+    out << "base_sha256=" << hexHash(delta.base_hash) << "\n";
+    out << "result_sha256=" << hexHash(delta.result_hash) << "\n";
+    out << "entries=" << (int)delta.entries.size() << "\n";
+
+    // Only image with delta applied is verified successfully
+    switch (ImageDelta::match(data, delta))
+    {
+    case DeltaResult:
+        out << "state=applied\n";
+        return ExitOk;
+    case DeltaBase:
+        out << "state=base\n";
+        return ExitParseError;
+    default:
+        out << "state=mismatch\n";
+        return fail(ExitParseError, mismatchString(data, delta));
+    }
+}
@@ -0,0 +1,242 @@
+/* dupes.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Fleet-wide duplicate MAC, UUID and MBSN check.
+// Directory images are parsed by pool tasks and their values are checked
+// against each other and against index of earlier batches. Index file is
+// memory-mapped and read only at values passing its Bloom filter, so check
+// time depends on batch size, not on fleet size. Batch is then merged
+// into index, replacing entries of the same files added before.
+
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include "common.h"
+#include "dupindex.h"
+
+static const char* FIELD_NAMES[] = {"mac", "uuid", "mbsn"};
+
+// Values and paths of batch images, shared by all workers
+class DupesBatch
+{
+public:
+    DupesBatch() : exitCode(ExitOk) {}
+
+    void add(const QString & path, const bios_t & bios)
+    {
+        QMutexLocker locker(&mutex);
+        DuplicateIndex::entries(bios, (uint32_t)paths.size(), entries);
+        paths.push_back(QFileInfo(path).absoluteFilePath().toUtf8().constData());
+    }
+
+    void failed(const QString & path, int code, const QString & message)
+    {
+        QMutexLocker locker(&mutex);
+        exitCode = qMax(exitCode, fail(code, QString("%1: %2").arg(path).arg(message)));
+    }
+
+    int result() const { return exitCode; }
+
+    std::vector<duplicate_entry_t> entries;
+    std::vector<std::string> paths;
+
+private:
+    QMutex mutex;
+    int exitCode;
+};
+
+class DupesTask : public QRunnable
+{
+public:
+    DupesTask(const QString & path, DupesBatch *batch, ImageCache *cache) : path(path), batch(batch), cache(cache) {}
+
+    void run()
+    {
+        bios_t bios;
+        memset(&bios, 0, sizeof(bios));
+        image_status_t status;
+        if (!readImage(path, cache, bios, status))
+            batch->failed(path, ExitIoError, "can't open file for reading");
+        else if (status.error != NoError)
+            batch->failed(path, ExitParseError, FD44Parser::errorString(status, QByteArray(), bios).replace('\n', ' '));
+        else
+            batch->add(path, bios);
+    }
+
+private:
+    QString path;
+    DupesBatch *batch;
+    ImageCache *cache;
+};
+
+static QString valueString(const duplicate_entry_t & entry)
+{
+    QByteArray value((const char*)entry.value, DUPLICATE_VALUE_LENGTH);
+    switch (entry.field)
+    {
+    case DuplicateMac:
+        return FD44Parser::fieldHex(value.left(MAC_LENGTH));
+    case DuplicateUuid:
+        return FD44Parser::fieldHex(value.left(UUID_LENGTH));
+    default:
+        return FD44Parser::fieldText(value);
+    }
+}
+
+int dupes(const QStringList & args)
+{
+    QString path, outputPath, cachePath, indexPath;
+    int threads = QThread::idealThreadCount();
+    bool all = false, update = true;
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if (arg == "--all")
+            all = true;
+        else if (arg == "--no-update")
+            update = false;
+        else if ((arg == "-j" || arg == "-o" || arg == "--output" || arg == "--cache" || arg == "--index") && i + 1 < args.size())
+        {
+            const QString & value = args.at(++i);
+            if (arg == "-j")
+                threads = value.toInt();
+            else if (arg == "--cache")
+                cachePath = value;
+            else if (arg == "--index")
+                indexPath = value;
+            else
+                outputPath = value;
+        }
+        else if (!arg.startsWith('-') && path.isEmpty())
+            path = arg;
+        else
+            return usage();
+    }
+
+    if (path.isEmpty() || threads < 1)
+        return usage();
+    if (!QFileInfo(path).isDir())
+        return fail(ExitIoError, QString("%1 is not a directory").arg(path));
+
+    // Index is checked before directory is parsed, so invalid one is reported at once
+    QFile indexFile(indexPath);
+    QByteArray indexBuffer;
+    ByteView indexData;
+    DuplicateIndex index;
+    if (!indexPath.isEmpty() && indexFile.exists())
+    {
+        if (!indexFile.open(QFile::ReadOnly))
+            return fail(ExitIoError, QString("can't open %1 for reading").arg(indexPath));
+        uchar *mapped = indexFile.map(0, indexFile.size());
+        if (mapped)
+            indexData = ByteView((const char*)mapped, (int)indexFile.size());
+        else
+        {
+            indexBuffer = indexFile.readAll();
+            indexData = ByteView(indexBuffer.constData(), indexBuffer.size());
+        }
+        if (!index.open(indexData))
+            return fail(ExitParseError, QString("%1 is not a valid duplicate index").arg(indexPath));
+    }
+
+    QFile outputFile;
+    if (outputPath.isEmpty())
+        outputFile.open(stdout, QFile::WriteOnly);
+    else
+    {
+        outputFile.setFileName(outputPath);
+        if (!outputFile.open(QFile::WriteOnly | QFile::Truncate))
+            return fail(ExitIoError, QString("can't open %1 for writing").arg(outputPath));
+    }
+
+    ImageCache cache;
+    if (!cachePath.isEmpty())
+        cache.load(cachePath);
+
+    DupesBatch batch;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+
+    QStringList nameFilters;
+    if (!all)
+        nameFilters << "*.rom" << "*.bin" << "*.cap";
+
+    QDirIterator it(path, nameFilters, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while (it.hasNext())
+        pool.start(new DupesTask(it.next(), &batch, cachePath.isEmpty() ? 0 : &cache));
+
+    pool.waitForDone();
+    if (!cache.save())
+        return fail(ExitIoError, QString("can't write %1").arg(cachePath));
+
+    // Every value of batch with all its images in batch and index,
+    // index entries of batch files are replaced, so they are not reported
+    std::vector<duplicate_entry_t> & entries = batch.entries;
+    std::stable_sort(entries.begin(), entries.end(), DuplicateIndex::lessThan);
+    std::unordered_set<std::string> batchPaths(batch.paths.begin(), batch.paths.end());
+
+    QTextStream out(&outputFile);
+    out << "field\tvalue\tpath\n";
+    int groups = 0;
+    for (size_t first = 0, last; first < entries.size(); first = last)
+    {
+        QStringList group;
+        for (last = first; last < entries.size() && !DuplicateIndex::lessThan(entries[first], entries[last]); last++)
+            group.append(QString::fromUtf8(batch.paths[entries[last].path].c_str()));
+
+        std::vector<duplicate_entry_t> found;
+        index.find(entries[first], found);
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            std::string indexed = index.path(found[i].path);
+            if (!batchPaths.count(indexed))
+                group.append(QString::fromUtf8(indexed.c_str()));
+        }
+
+        if (group.size() < 2)
+            continue;
+        groups++;
+        group.sort();
+        for (int i = 0; i < group.size(); i++)
+            out << FIELD_NAMES[entries[first].field] << "\t" << valueString(entries[first]) << "\t" << group.at(i) << "\n";
+    }
+    out.flush();
+
+    // New index replaces old one in single rename, so failed update keeps old index
+    if (!indexPath.isEmpty() && update)
+    {
+        std::vector<uint8_t> data;
+        DuplicateIndex::write(index, entries, batch.paths, data);
+        indexFile.close();
+
+        if (!ImageWriter::write(indexPath, QByteArray((const char*)data.data(), (int)data.size())))
+            return fail(ExitIoError, QString("can't write %1").arg(indexPath));
+    }
+
+    // Check of batch with failed images is incomplete even without duplicates
+    return qMax(batch.result(), groups ? (int)ExitDuplicates : (int)ExitOk);
+}
@@ -0,0 +1,238 @@
+/* fd44.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Command-line interface to FD44 parser.
+// Uses QtCore only and never constructs application object, so it starts
+// without GUI libraries and display connection.
+
+#include <stdio.h>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "common.h"
+
+int usage()
+{
+    QTextStream err(stderr);
+    err << "Usage: fd44 info <image>\n"
+           "       fd44 patch <image> [options]\n"
+           "       fd44 scan <directory> [-j <threads>] [--all] [-o <file>] [--cache <file>]\n"
+           "       fd44 batch <template> <manifest.csv> -o <directory> [-j <threads>] [--delta]\n"
+           "       fd44 apply <image> <delta> [-o <file>]\n"
+           "       fd44 verify <image> <delta>\n"
+           "       fd44 dupes <directory> [--index <file>] [--no-update] [-j <threads>] [--all] [-o <file>] [--cache <file>]\n"
+           "\n"
+           "Patch options:\n"
+           "  --mac <hex>           primary LAN MAC address, 6 bytes\n"
+           "  --uuid <hex>          system UUID without MAC part, 10 bytes\n"
+           "  --mbsn <text>         motherboard S/N, 15 characters\n"
+           "  --dts <hex>           DTS key, 8 bytes\n"
+           "  --mac-type <type>     MAC storage: uuid, ascii or gbe\n"
+           "  --mac-magic <hex>     ASCII MAC magic byte\n"
+           "  --dts-type <type>     DTS key type: none, short or long\n"
+           "  --dts-magic <1|2|3>   long DTS key magic variant\n"
+           "  -o, --output <file>   output file, image is patched in place by default\n"
+           "  -d, --delta <file>    write delta file against image instead of patching it\n"
+           "\n"
+           "Scan options:\n"
+           "  -j <threads>          number of worker threads, all cores by default\n"
+           "  --all                 scan all files, not only *.rom, *.bin and *.cap\n"
+           "  -o, --output <file>   tab-separated inventory file, stdout by default\n"
+           "  --cache <file>        parse cache, unchanged images are not read again\n"
+           "\n"
+           "Batch options:\n"
+           "  -j <threads>          number of worker threads, all cores by default\n"
+           "  -o, --output <dir>    directory for personalized images\n"
+           "  --delta               write delta files against template instead of images\n"
+           "Manifest is comma-separated with header line, \"file\" column names output image,\n"
+           "optional \"mac\", \"uuid\", \"mbsn\" and \"dts\" columns replace template values.\n"
+           "\n"
+           "Apply writes delta to its base image, verify checks that image is the delta result.\n"
+           "\n"
+           "Dupes options:\n"
+           "  --index <file>        fleet index, directory images are checked against it and added to it\n"
+           "  --no-update           check against index without adding images to it\n"
+           "  -j, --all, --cache    same as for scan\n"
+           "  -o, --output <file>   tab-separated report, stdout by default\n"
+           "Every image with MAC, UUID or MBSN also found in another image is reported,\n"
+           "exit code is 4 if any are found, non-zero also if any image can't be read or parsed.\n";
+    return ExitUsage;
+}
+
+static int info(const QStringList & args)
+{
+    if (args.size() != 1)
+        return usage();
+
+    ImageFile image;
+    if (!image.open(args.at(0)))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(args.at(0)));
+
+    bios_t bios;
+    image_status_t status = FD44Parser::readFromBIOS(image.data(), bios);
+    if (status.error != NoError)
+        return fail(ExitParseError, FD44Parser::errorString(status, image.data(), bios));
+
+    QTextStream out(stdout);
+    QStringList keys = recordKeys();
+    QStringList values = recordValues(bios, QString());
+    // Last field is parse error, it is reported above
+    for (int i = 0; i < keys.size() - 1; i++)
+        out << keys.at(i) << "=" << values.at(i) << "\n";
+
+    return ExitOk;
+}
+
+static int patch(const QStringList & args)
+{
+    QString path, output, delta;
+    QString mac, uuid, mbsn, dts, macType, macMagic, dtsType, dtsMagic;
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if (!arg.startsWith('-'))
+        {
+            if (!path.isEmpty())
+                return usage();
+            path = arg;
+            continue;
+        }
+
+        if (i + 1 >= args.size())
+            return usage();
+        const QString & value = args.at(++i);
+
+        if (arg == "--mac")
+            mac = value;
+        else if (arg == "--uuid")
+            uuid = value;
+        else if (arg == "--mbsn")
+            mbsn = value;
+        else if (arg == "--dts")
+            dts = value;
+        else if (arg == "--mac-type")
+            macType = value;
+        else if (arg == "--mac-magic")
+            macMagic = value;
+        else if (arg == "--dts-type")
+            dtsType = value;
+        else if (arg == "--dts-magic")
+            dtsMagic = value;
+        else if (arg == "-o" || arg == "--output")
+            output = value;
+        else if (arg == "-d" || arg == "--delta")
+            delta = value;
+        else
+            return usage();
+    }
+
+    if (path.isEmpty())
+        return usage();
+    if (output.isEmpty())
+        output = path;
+
+    ImageFile image;
+    if (!image.open(path))
+        return fail(ExitIoError, QString("can't open %1 for reading").arg(path));
+
+    bios_t bios;
+    image_status_t status = FD44Parser::readFromBIOS(image.data(), bios);
+    if (status.error != NoError)
+        return fail(ExitParseError, FD44Parser::errorString(status, image.data(), bios));
+
+    setDefaultTypes(bios);
+
+    // Applying new values
+    if (macType == "uuid")
+        bios.mac_type = UUID;
+    else if (macType == "ascii" && bios.mac_header != NoHeader)
+        bios.mac_type = ASCII;
+    else if (macType == "gbe")
+        bios.mac_type = GbE;
+    else if (!macType.isEmpty())
+        return fail(ExitUsage, QString("MAC storage type %1 is not supported by this image").arg(macType));
+
+    if (dtsType == "none")
+        bios.dts_type = None;
+    else if (dtsType == "short" && bios.dts_short_header != NoHeader)
+        bios.dts_type = Short;
+    else if (dtsType == "long" && bios.dts_long_header != NoHeader)
+        bios.dts_type = Long;
+    else if (!dtsType.isEmpty())
+        return fail(ExitUsage, QString("DTS key type %1 is not supported by this image").arg(dtsType));
+
+    if (dtsMagic == "1")
+        FD44Parser::setField(bios, DtsMagicField, toByteArray(DTS_LONG_MAGIC_V1));
+    else if (dtsMagic == "2")
+        FD44Parser::setField(bios, DtsMagicField, toByteArray(DTS_LONG_MAGIC_V2));
+    else if (dtsMagic == "3")
+        FD44Parser::setField(bios, DtsMagicField, toByteArray(DTS_LONG_MAGIC_V3));
+    else if (!dtsMagic.isEmpty())
+        return fail(ExitUsage, QString("unknown DTS key magic %1").arg(dtsMagic));
+
+    if (!macMagic.isEmpty() && !setHexField(bios, MacMagicField, macMagic, ASCII_MAC_MAGIC_LENGTH))
+        return fail(ExitUsage, "MAC magic must be 1 hex byte");
+    QString error = setValues(bios, mac, uuid, mbsn, dts);
+    if (error.isEmpty())
+        error = missingValue(bios);
+    if (!error.isEmpty())
+        return fail(ExitUsage, error);
+
+    QList<patch_t> patches;
+    status = FD44Parser::buildPatches(image.data(), bios, patches);
+    if (status.error != NoError)
+        return fail(ExitParseError, FD44Parser::errorString(status, image.data(), bios));
+
+    if (!delta.isEmpty())
+        output = delta;
+    bool written = delta.isEmpty() ? writeImage(image, path, output, patches)
+                                   : writeDelta(delta, image.data(), patches);
+    if (!written)
+        return fail(ExitIoError, QString("can't write %1").arg(output));
+
+    QTextStream out(stdout);
+    out << "written=" << output << "\n";
+    return ExitOk;
+}
+
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for (int i = 1; i < argc; i++)
+        args.append(QString::fromLocal8Bit(argv[i]));
+
+    if (args.isEmpty())
+        return usage();
+
+    QString command = args.takeFirst();
+    if (command == "info")
+        return info(args);
+    if (command == "patch")
+        return patch(args);
+    if (command == "scan")
+        return scan(args);
+    if (command == "batch")
+        return batch(args);
+    if (command == "apply")
+        return apply(args);
+    if (command == "verify")
+        return verify(args);
+    if (command == "dupes")
+        return dupes(args);
+
+    return usage();
+}
@@ -0,0 +1,18 @@
+QT       = core
+
+TARGET = fd44
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES += fd44.cpp \
+    batch.cpp \
+    common.cpp \
+    delta.cpp \
+    dupes.cpp \
+    scan.cpp
+
+HEADERS += common.h
+
+include(../fd44core.pri)
@@ -0,0 +1,205 @@
+/* scan.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Directory-wide inventory scan.
+// Image paths are split between workers, each one has its own queue
+// and idle workers steal images from the other queues, so one slow or
+// corrupt image occupies only one worker and workers don't contend for
+// a shared queue. With parse cache only new and changed images are read.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include "common.h"
+
+// Inventory output shared by all workers
+class ScanOutput
+{
+public:
+    ScanOutput(QIODevice *device) : stream(device) {}
+
+    void write(const QString & path, const QStringList & values)
+    {
+        QMutexLocker locker(&mutex);
+        stream << path << "\t" << values.join("\t") << "\n";
+    }
+
+private:
+    QMutex mutex;
+    QTextStream stream;
+};
+
+// Image paths of one worker. Owner takes them from the front and idle
+// workers steal from the back, so they rarely wait for the same lock.
+class ScanQueue
+{
+public:
+    // Paths are added before workers are started
+    void append(const QString & path) { paths.append(path); }
+
+    bool take(QString & path, bool steal)
+    {
+        QMutexLocker locker(&mutex);
+        if (paths.isEmpty())
+            return false;
+        path = steal ? paths.takeLast() : paths.takeFirst();
+        return true;
+    }
+
+private:
+    QMutex mutex;
+    QStringList paths;
+};
+
+class ScanWorker : public QRunnable
+{
+public:
+    ScanWorker(int index, const QList<ScanQueue*> & queues, ScanOutput *output, ImageCache *cache)
+        : index(index), queues(queues), output(output), cache(cache) {}
+
+    void run()
+    {
+        QString path;
+        while (next(path))
+            scanImage(path);
+    }
+
+private:
+    // Own queue first, then other queues starting from the next one.
+    // No paths are added while workers run, so all queues are empty
+    // when none has a path left.
+    bool next(QString & path)
+    {
+        if (queues.at(index)->take(path, false))
+            return true;
+        for (int i = 1; i < queues.size(); i++)
+        {
+            if (queues.at((index + i) % queues.size())->take(path, true))
+                return true;
+        }
+        return false;
+    }
+
+    void scanImage(const QString & path)
+    {
+        bios_t bios;
+        memset(&bios, 0, sizeof(bios));
+        image_status_t status;
+        if (readImage(path, cache, bios, status))
+        {
+            // Message is only formatted for failed images, parsing errors don't refer to image data
+            QString error;
+            if (status.error != NoError)
+                error = FD44Parser::errorString(status, QByteArray(), bios);
+            output->write(path, recordValues(bios, error));
+        }
+        else
+        {
+            bios.state = ParseError;
+            output->write(path, recordValues(bios, "Can't open file for reading."));
+        }
+    }
+
+    int index;
+    QList<ScanQueue*> queues;
+    ScanOutput *output;
+    ImageCache *cache;
+};
+
+int scan(const QStringList & args)
+{
+    QString path, outputPath, cachePath;
+    int threads = QThread::idealThreadCount();
+    bool all = false;
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if (arg == "--all")
+            all = true;
+        else if ((arg == "-j" || arg == "-o" || arg == "--output" || arg == "--cache") && i + 1 < args.size())
+        {
+            const QString & value = args.at(++i);
+            if (arg == "-j")
+                threads = value.toInt();
+            else if (arg == "--cache")
+                cachePath = value;
+            else
+                outputPath = value;
+        }
+        else if (!arg.startsWith('-') && path.isEmpty())
+            path = arg;
+        else
+            return usage();
+    }
+
+    if (path.isEmpty() || threads < 1)
+        return usage();
+    if (!QFileInfo(path).isDir())
+        return fail(ExitIoError, QString("%1 is not a directory").arg(path));
+
+    QFile outputFile;
+    if (outputPath.isEmpty())
+        outputFile.open(stdout, QFile::WriteOnly);
+    else
+    {
+        outputFile.setFileName(outputPath);
+        if (!outputFile.open(QFile::WriteOnly | QFile::Truncate))
+            return fail(ExitIoError, QString("can't open %1 for writing").arg(outputPath));
+    }
+
+    ScanOutput output(&outputFile);
+    output.write("path", recordKeys());
+
+    ImageCache cache;
+    if (!cachePath.isEmpty())
+        cache.load(cachePath);
+
+    QStringList nameFilters;
+    if (!all)
+        nameFilters << "*.rom" << "*.bin" << "*.cap";
+
+    QStringList paths;
+    QDirIterator it(path, nameFilters, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while (it.hasNext())
+        paths.append(it.next());
+
+    // Every worker starts with equal contiguous part of paths
+    threads = qMax(1, qMin(threads, paths.size()));
+    QList<ScanQueue*> queues;
+    for (int i = 0; i < threads; i++)
+        queues.append(new ScanQueue);
+    for (int i = 0; i < paths.size(); i++)
+        queues.at((int)((qint64)i * threads / paths.size()))->append(paths.at(i));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < threads; i++)
+        pool.start(new ScanWorker(i, queues, &output, cachePath.isEmpty() ? 0 : &cache));
+    pool.waitForDone();
+    qDeleteAll(queues);
+    if (!cache.save())
+        return fail(ExitIoError, QString("can't write %1").arg(cachePath));
+    return ExitOk;
+}
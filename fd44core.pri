@@ -0,0 +1,17 @@
+# BIOS image parsing code shared by GUI and command-line tool, QtCore only
+# Qt-free parser is in libfd44, this adds Qt interface and file access
+
+include(libfd44/libfd44.pri)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += $$PWD/fd44parser.cpp \
+    $$PWD/imagecache.cpp \
+    $$PWD/imagefile.cpp \
+    $$PWD/imagewriter.cpp
+
+HEADERS += $$PWD/fd44parser.h \
+    $$PWD/imagecache.h \
+    $$PWD/imagefile.h \
+    $$PWD/imagewriter.h
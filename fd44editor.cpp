@@ -11,14 +11,57 @@
 
 */
 
+#include <string.h>
+
+#include <QDir>
+#include <QHeaderView>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
 #include "fd44editor.h"
 #include "ui_fd44editor.h"
 
 FD44Editor::FD44Editor(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::FD44Editor)
+    ui(new Ui::FD44Editor),
+    job(0)
 {
     ui->setupUi(this);
+    memset(&opened, 0, sizeof(opened));
+
+    // Progress of background load and save
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, 100);
+    progressBar->hide();
+    cancelButton = new QPushButton(tr("Cancel"), this);
+    cancelButton->hide();
+    ui->statusBar->addPermanentWidget(progressBar);
+    ui->statusBar->addPermanentWidget(cancelButton);
+
+    // Table of dropped files, shown on first drop of several files or a folder
+    listModel = new ImageListModel(&cache, this);
+    listProxy = new QSortFilterProxyModel(this);
+    listProxy->setSourceModel(listModel);
+    listProxy->setDynamicSortFilter(true);
+    listView = new QTableView(this);
+    listView->setModel(listProxy);
+    listView->setSortingEnabled(true);
+    listView->sortByColumn(ImageListModel::FileColumn, Qt::AscendingOrder);
+    listView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    listView->setSelectionMode(QAbstractItemView::SingleSelection);
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    listView->verticalHeader()->hide();
+    listView->horizontalHeader()->setStretchLastSection(true);
+    listDock = new QDockWidget(tr("Dropped images"), this);
+    listDock->setObjectName("listDock");
+    listDock->setWidget(listView);
+    listDock->hide();
+    addDockWidget(Qt::BottomDockWidgetArea, listDock);
+    connect(listModel, SIGNAL(finished()), this, SLOT(listFinished()));
+    connect(listView, SIGNAL(clicked(QModelIndex)), this, SLOT(openListedImage(QModelIndex)));
 
     // Signal-slot connections
     connect(ui->fromFileButton, SIGNAL(clicked()), this, SLOT(openImageFile()));
@@ -37,13 +80,29 @@ FD44Editor::FD44Editor(QWidget *parent) :
     this->setAcceptDrops(true);
 
     // Populating DTS magic combobox with data
-    ui->dtsMagicComboBox->setItemData(0, DTS_LONG_MAGIC_V1);
-    ui->dtsMagicComboBox->setItemData(1, DTS_LONG_MAGIC_V2);
-    ui->dtsMagicComboBox->setItemData(2, DTS_LONG_MAGIC_V3);
+    ui->dtsMagicComboBox->setItemData(0, toByteArray(DTS_LONG_MAGIC_V1));
+    ui->dtsMagicComboBox->setItemData(1, toByteArray(DTS_LONG_MAGIC_V2));
+    ui->dtsMagicComboBox->setItemData(2, toByteArray(DTS_LONG_MAGIC_V3));
+
+    // Parse results of opened files are kept in user cache directory
+#if QT_VERSION >= 0x050000
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    QString cacheDir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+    if (!cacheDir.isEmpty() && QDir().mkpath(cacheDir))
+        cache.load(QDir(cacheDir).filePath("parse.cache"));
 }
 
 FD44Editor::~FD44Editor()
 {
+    // Running save is finished, running load is canceled
+    if (job && job->type() == ImageJob::LoadJob)
+        job->cancel();
+    pool.waitForDone();
+    delete job;
+    // List tasks use cache, so they are finished before it is destroyed
+    delete listModel;
     delete ui;
 }
 
@@ -62,22 +121,7 @@ void FD44Editor::openImageFile(QString path)
         return;
     }
 
-    QFile inputFile;
-    inputFile.setFileName(path);
-
-    if (!inputFile.open(QFile::ReadOnly))
-    {
-        ui->statusBar->showMessage(tr("Can't open file for reading. Check file permissions."));
-        return;
-    }
-
-    QByteArray biosImage = inputFile.readAll();
-    inputFile.close();
-
-    if (writeToUI(readFromBIOS(biosImage)))
-        ui->statusBar->showMessage(tr("Loaded: %1").arg(fileInfo.fileName()));
-
-	ui->toClipboardButton->setEnabled(true);
+    startJob(new ImageJob(ImageJob::LoadJob, path, &cache));
 }
 
 void FD44Editor::saveImageFile()
@@ -91,566 +135,70 @@ void FD44Editor::saveImageFile()
         return;
     }
 
-    QFile outputFile;
-    outputFile.setFileName(path);
-    if (!outputFile.open(QFile::ReadWrite))
-    {
-        ui->statusBar->showMessage(tr("Can't open file for writing. Check file permissions."));
-        return;
-    }
-
-    QByteArray bios = outputFile.readAll();
-
-    // Remove capsule header
-    if (bios.left(APTIO_CAPSULE_GUID.length()) == APTIO_CAPSULE_GUID)
-    {
-        APTIO_CAPSULE_HEADER *header = (APTIO_CAPSULE_HEADER*) bios.data();
-        bios = bios.mid(header->RomImageOffset); 
-    }
-
-    QByteArray newBios = writeToBIOS(bios, readFromUI());
-    if (newBios.isEmpty())
-    {
-        QMessageBox::critical(this, tr("Fatal error"), tr("Error parsing output file.\n%1").arg(lastError));
-        return;
-    }
-    
-    outputFile.resize(bios.length());
-    outputFile.seek(0);
-    outputFile.write(newBios);
-    outputFile.close();
-    outputFile.rename(QString("%1/%2.bin").arg(fileInfo.path()).arg(fileInfo.completeBaseName()));
-
-    ui->statusBar->showMessage(tr("Written: %1.bin").arg(fileInfo.completeBaseName()));
+    startJob(new ImageJob(ImageJob::SaveJob, path, &cache, readFromUI()));
 }
 
-bios_t FD44Editor::readFromBIOS(const QByteArray & data)
+void FD44Editor::startJob(ImageJob *newJob)
 {
-    bios_t bios;
-
-	// Setting default values
-	bios.mac_type = MacNotDetected;
-
-    // Detecting motherboard model and BIOS version
-    int pos = data.lastIndexOf(BOOTEFI_HEADER);
-    if (pos == -1)
-    {
-        lastError = tr("$BOOTEFI$ signature not found.\nPlease open correct ASUS BIOS file.");
-        bios.state = ParseError;
-        return bios;
-    }
-
-    pos += BOOTEFI_HEADER.length() + BOOTEFI_MAGIC_LENGTH;
-    bios.bios_version = data.mid(pos, BOOTEFI_BIOS_VERSION_LENGTH);
-    pos += BOOTEFI_BIOS_VERSION_LENGTH;
-    bios.motherboard_name = data.mid(pos, BOOTEFI_MOTHERBOARD_NAME_LENGTH);
-    pos += BOOTEFI_MOTHERBOARD_NAME_LENGTH + BOOTEFI_BIOS_DATE_OFFSET;
-    bios.bios_date = data.mid(pos, BOOTEFI_BIOS_DATE_LENGTH);
-	pos += BOOTEFI_BIOS_DATE_LENGTH + BOOTEFI_RECOVERY_NAME_OFFSET;
-	bios.recovery_name = data.mid(pos, BOOTEFI_RECOVERY_NAME_LENGTH);
-
-    // Searching for that board in database
-    int dbIndex = -1;
-
-    for(int i = 0; i < SUPPORTED_MOTHERBOARDS_LIST_LENGTH; i++)
-    {
-        QByteArray motherboard_name = QByteArray(SUPPORTED_MOTHERBOARDS_LIST[i].name, bios.motherboard_name.length());
-        if (!qstrcmp(motherboard_name, bios.motherboard_name))
-        {
-            dbIndex = i;
-            break;
-        }
-    }
-
-    // Detecting ME presence and version
-    bool isFull = false;
-	pos = data.indexOf(ME_HEADER);
-    if (pos != -1)
-    {
-        if (data.indexOf(ME_5M_SIGN, pos) != -1)
-			bios.me_type = ME_5M;
-		else if (data.indexOf(ME_3M_SIGN, pos) != -1)
-			bios.me_type = ME_3M;
-		else 
-			bios.me_type = ME_15M;
-
-		pos = data.indexOf(ME_VERSION_HEADER, pos);
-        if (pos != -1)
-        {
-			bios.me_version = data.mid(pos + ME_VERSION_HEADER.length() + ME_VERSION_OFFSET, ME_VERSION_LENGTH);
-			isFull = true;
-        }
-    }
-
-    // Detecting GbE presence and version
-    bool macFound = false;
-    pos = data.indexOf(GBE_HEADER);
-    if (pos != -1)
-    {
-        int pos2 = data.lastIndexOf(GBE_HEADER);
-        if (pos != pos2 && data.mid(pos + GBE_MAC_OFFSET - MAC_LENGTH, MAC_LENGTH) == GBE_MAC_STUB)
-            pos = pos2;
-
-        bios.mac = data.mid(pos + GBE_MAC_OFFSET - MAC_LENGTH, MAC_LENGTH);
-        bios.gbe_version = data.mid(pos + GBE_VERSION_OFFSET, GBE_VERSION_LENGTH);
-        bios.mac_type = GbE;
-        macFound = true;
-    }
-
-    // Searching for non-empty module
-    pos = data.indexOf(MODULE_HEADER);
-    if (pos == -1)
-    {
-        lastError = tr("FD44 module not found.");
-        bios.state = ParseError;
-        return bios;
-    }
-
-    bool isEmpty = true;
-    unsigned int moduleLength;
-    QByteArray module, moduleBody, moduleVersion;
-    while (isEmpty && pos != -1)
-    {
-        // Checking for BSA_ signature
-        if (data.mid(pos + MODULE_HEADER_BSA_OFFSET, MODULE_HEADER_BSA.length()) != MODULE_HEADER_BSA)
-        {
-            pos = data.indexOf(MODULE_HEADER, pos+1);
-            continue;
-        }
-        
-        // Reading module length
-        moduleLength = (data.at(pos + MODULE_LENGTH_OFFSET + 2) << 16) +
-                       (data.at(pos + MODULE_LENGTH_OFFSET + 1) << 8)  +
-                        data.at(pos + MODULE_LENGTH_OFFSET);
-        
-        module = data.mid(pos, moduleLength);
-
-        // Determining version
-        moduleVersion = module.mid(MODULE_VERSION_OFFSET, MODULE_VERSION_LENGTH);
-        if (MODULE_VERSIONS.indexOf(moduleVersion) < 0)
-        {
-            lastError = tr("FD44 module version is unknown.");
-            bios.state = ParseError;
-            return bios;
-        }
-
-        // Setting up module structure depending on detected module version
-        // X79 motherboards have similar FD44 module header, but different data format.
-        bool x79board = (bios.motherboard_name.indexOf("X79") != -1 || bios.motherboard_name.indexOf("Rampage-IV") != -1);
-        
-		// C20x motherboards have similar FD44 module header, but different data format.
-		// TODO: replace detection algorithm, too many exclusions
-		bool c20xboard = (bios.motherboard_name.indexOf("P8B-") != -1);
-		
-		bios.module_version = moduleVersion;
-        switch (MODULE_VERSIONS.indexOf(bios.module_version))
-        {
-        case 0: // 6 series or X79 or C20x
-            if (x79board) // X79
-            {
-                bios.mac_header = QByteArray();
-                bios.dts_short_header = QByteArray();
-                bios.dts_long_header = DTS_LONG_HEADER_X79;
-                bios.mbsn_header = MBSN_HEADER_X79;
-                bios.uuid_header = UUID_HEADER_X79;
-            }
-			else if (c20xboard)	// C20x
-			{
-				bios.mac_header = QByteArray();
-				bios.dts_short_header = QByteArray();
-				bios.dts_long_header = QByteArray();
-				bios.mbsn_header = MBSN_HEADER_7_SERIES;
-				bios.uuid_header = UUID_HEADER_7_SERIES;
-			}
-			else // 6 series
-			{
-                bios.mac_header = ASCII_MAC_HEADER_6_SERIES;
-                bios.dts_short_header = DTS_SHORT_HEADER_6_SERIES;
-                bios.dts_long_header = DTS_LONG_HEADER_6_SERIES;
-                bios.mbsn_header = MBSN_HEADER_6_SERIES;
-                bios.uuid_header = UUID_HEADER_6_SERIES;
-            }
-            break;
-        case 1: // C602
-            bios.mac_header = QByteArray();
-            bios.dts_short_header = QByteArray();
-            bios.dts_long_header = QByteArray();
-            bios.mbsn_header = MBSN_HEADER_7_SERIES;
-            bios.uuid_header = UUID_HEADER_7_SERIES;
-            break;
-        case 2: // 7 and 8 series
-            bios.mac_header = ASCII_MAC_HEADER_7_SERIES;
-            bios.dts_short_header = QByteArray();
-            bios.dts_long_header = DTS_LONG_HEADER_7_SERIES;
-            bios.mbsn_header = MBSN_HEADER_7_SERIES;
-            bios.uuid_header = UUID_HEADER_7_SERIES;
-            break;
-        case 3: // 9 series
-            bios.mac_header = ASCII_MAC_HEADER_7_SERIES;
-            bios.dts_short_header = QByteArray();
-            bios.dts_long_header = QByteArray();
-            bios.mbsn_header = MBSN_HEADER_7_SERIES;
-            bios.uuid_header = UUID_HEADER_7_SERIES;
-            break;
-        default:
-            lastError = tr("No valid structure setup path for this module version.");
-            bios.state = ParseError;
-            return bios;
-        }
-
-        pos += MODULE_HEADER_LENGTH;
-        
-        // Checking for empty module
-        moduleBody = module.right(moduleLength - MODULE_HEADER_LENGTH);
-        if (moduleBody.count('\xFF') != moduleBody.size())
-            isEmpty = false;
-        else
-            pos = data.indexOf(MODULE_HEADER, pos+1);
-    }
-
-    if (isEmpty)
-    {
-        // Trying to detect module data format from board database
-        if (dbIndex >= 0)
-        {
-            bios.mac_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_type;
-            bios.mac_magic = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_magic;
-            bios.dts_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_type;
-            bios.dts_magic = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_magic;
-            bios.state = Empty;
-        }
-        else
-        {
-            bios.mac_magic = QByteArray();
-            bios.dts_type = DtsNotDetected;
-            bios.dts_magic = QByteArray();
-            bios.state = HasNotDetectedValues;
-        }
-
-        return bios;
-    }
-
-    // Detecting MAC address type and value
-    // Searching for ASCII MAC
-    if (!bios.mac_header.isEmpty() && bios.mac_type != GbE)
-    {
-        pos = moduleBody.indexOf(bios.mac_header);
-        if (pos != -1 )
-        {
-            pos += bios.mac_header.length();
-
-            if (bios.mac_header == ASCII_MAC_HEADER_7_SERIES)
-            {
-                bios.mac_magic = moduleBody.mid(pos, ASCII_MAC_MAGIC_LENGTH);
-                pos += ASCII_MAC_OFFSET;
-            }
-
-            bios.mac = QByteArray::fromHex(moduleBody.mid(pos, ASCII_MAC_LENGTH));
-            bios.mac_type = ASCII;
-            macFound = true;
-        }
-    }
-
-    if (!macFound)
-    {
-        if (dbIndex >= 0)
-        {
-            bios.mac_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_type;
-            bios.mac_magic = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_magic;
-        }
-        else
-        {
-            bios.mac_type = MacNotDetected;
-            bios.mac_magic = QByteArray();
-        }
-    }
-    
-    // Searching for DTS key
-    bool dtsFound = false;
-    // Searching for short DTS
-    if (!bios.dts_short_header.isEmpty())
-    {
-        pos = moduleBody.indexOf(bios.dts_short_header);
-        if (pos != -1)
-        {
-            pos += bios.dts_short_header.length();
-            bios.dts_key = moduleBody.mid(pos, DTS_KEY_LENGTH);
-            pos += DTS_KEY_LENGTH;
-
-            if (moduleBody.mid(pos, DTS_SHORT_PART2.length()) != DTS_SHORT_PART2)
-            {
-                lastError = tr("Part 2 of short DTS key is unknown.");
-                bios.state = ParseError;
-                return bios;
-            }
-
-            bios.dts_type = Short;
-            dtsFound = true;
-        }
-    }
-
-    // Searching for long DTS
-    if (bios.dts_type != Short && !bios.dts_long_header.isEmpty())
-    {
-        pos = moduleBody.indexOf(bios.dts_long_header);
-        if (pos != -1)
-        {
-            pos += bios.dts_long_header.length();
-            bios.dts_key = moduleBody.mid(pos, DTS_KEY_LENGTH);
-            pos += DTS_KEY_LENGTH;
-
-            if (moduleBody.mid(pos, DTS_LONG_PART2.length()) !=DTS_LONG_PART2)
-            {
-                lastError = tr("Part 2 of long DTS key is unknown.");
-                bios.state = ParseError;
-                return bios;
-            }
-            pos += DTS_LONG_PART2.length();
-
-            bios.dts_magic = moduleBody.mid(pos, DTS_LONG_MAGIC_LENGTH);
-            pos += DTS_LONG_MAGIC_LENGTH;
-
-            if (moduleBody.mid(pos, DTS_LONG_PART3.length()) != DTS_LONG_PART3)
-            {
-                lastError = tr("Part 3 of long DTS key is unknown.");
-                bios.state = ParseError;
-                return bios;
-            }
-            pos += DTS_LONG_PART3.length();
-
-            QByteArray reversedKey = moduleBody.mid(pos, DTS_KEY_LENGTH);
-            bool reversed = true;
-            for(unsigned int i = 0; i < DTS_KEY_LENGTH; i++)
-            {
-                reversed = reversed && (bios.dts_key.at(i) == (reversedKey.at(DTS_KEY_LENGTH-1-i) ^ DTS_LONG_MASK[i]));
-            }
-            if (!reversed)
-            {
-                lastError = tr("Long DTS key reversed bytes section is corrupted.");
-                bios.state = ParseError;
-                return bios;
-            }
-            pos += DTS_KEY_LENGTH;
-
-            if (moduleBody.mid(pos, DTS_LONG_PART4.length()) != DTS_LONG_PART4)
-            {
-                lastError = tr("Part 4 of long DTS header is unknown.");
-                bios.state = ParseError;
-                return bios;
-            }
-
-            bios.dts_type = Long;
-            dtsFound = true;
-        }
-    }
-
-    if (!dtsFound)
-    {
-        if (dbIndex >= 0)
-        {
-            bios.dts_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_type;
-            bios.dts_magic = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_magic;
-        }
-        else
-        {
-            bios.dts_type = DtsNotDetected;
-            bios.dts_magic = QByteArray();
-        }
-    }
-
-    // Searching for UUID
-    if (!bios.uuid_header.isEmpty())
-    {
-        pos = moduleBody.indexOf(bios.uuid_header);
-        if (pos == -1)
-        {
-            lastError = tr("System UUID required but not found.");
-            bios.state = ParseError;
-            return bios;  
-        }
-        pos += bios.uuid_header.length();
-        bios.uuid = moduleBody.mid(pos, UUID_LENGTH);
-        
-        // MAC part of UUID
-        if (!macFound || bios.mac_type == UUID)
-        {
-            bios.mac = bios.uuid.right(MAC_LENGTH);
-        }
-    }
-
-    // Searching for MBSN
-    if (!bios.mbsn_header.isEmpty())
-    {
-        pos = moduleBody.indexOf(bios.mbsn_header);
-        if (pos == -1)
-        {
-            lastError = tr("Motherboard S/N required but not found.");
-            bios.state = ParseError;
-            return bios;
-        }
-        pos += bios.mbsn_header.length();
-        bios.mbsn = moduleBody.mid(pos, MBSN_BODY_LENGTH);
-    }
-
-    // Checking for not detected values
-    if (bios.mac_type == MacNotDetected || bios.dts_type == DtsNotDetected)
-        bios.state = HasNotDetectedValues;
-    else
-        bios.state = Valid;
-
-    return bios;
+    job = newJob;
+    connect(job, SIGNAL(progress(int)), progressBar, SLOT(setValue(int)));
+    connect(job, SIGNAL(finished()), this, SLOT(jobFinished()));
+    connect(cancelButton, SIGNAL(clicked()), job, SLOT(cancel()));
+
+    ui->centralWidget->setEnabled(false);
+    ui->statusBar->showMessage(job->type() == ImageJob::LoadJob ? tr("Loading: %1").arg(job->fileInfo().fileName())
+                                                                : tr("Writing: %1").arg(job->fileInfo().fileName()));
+    progressBar->setValue(0);
+    progressBar->show();
+    cancelButton->show();
+    pool.start(job);
 }
 
-QByteArray FD44Editor::writeToBIOS(const QByteArray & data, const bios_t & bios)
+void FD44Editor::jobFinished()
 {
-    // Checking for BOOTEFI header
-    int pos = data.indexOf(BOOTEFI_HEADER);
-    if (pos == -1)
-    {
-        lastError = tr("$BOOTEFI$ signature not found in output file.\nPlease open correct ASUS BIOS file.");
-        return QByteArray();
-    }
-
-    // Checking for module presence
-    pos = data.indexOf(MODULE_HEADER);
-    if (pos == -1)
-    {
-        lastError = tr("FD44 module not found in output file.");
-        return QByteArray();
-    }
-
-    // Checking motherboard name
-    pos += BOOTEFI_HEADER.length() + BOOTEFI_MAGIC_LENGTH + BOOTEFI_BIOS_VERSION_LENGTH;
-    QByteArray motherboard_name = data.mid(pos, BOOTEFI_MOTHERBOARD_NAME_LENGTH);   
-    if (!qstrcmp(bios.motherboard_name, motherboard_name))
-    {
-        lastError = tr("Motherboard model in in output file differs from model in loaded data.\n"\
-                       "Loaded: %1\n"\
-                       "File: %2")
-                       .arg(QString(bios.motherboard_name))
-                       .arg(QString(motherboard_name));
-        return QByteArray();
-    }
-
-    QByteArray module;
-    
-    // MAC
-    if (bios.mac_type == ASCII)
-    {
-        module.append(bios.mac_header);
-        if (bios.mac_header == ASCII_MAC_HEADER_7_SERIES)
-        {
-            module.append(bios.mac_magic);
-            module.append('\x00');
-        }
-        module.append(bios.mac.toHex().toUpper());
-        module.append('\x00');
-    }
-   
-    // Short DTS key
-    if (bios.dts_type == Short)
-    {
-        module.append(bios.dts_short_header);
-        module.append(bios.dts_key);
-        module.append(DTS_SHORT_PART2);
-    }
-
-    // Long DTS key
-    if (bios.dts_type == Long)
-    {
-        module.append(bios.dts_long_header);
-        module.append(bios.dts_key);
-        module.append(DTS_LONG_PART2);
-        module.append(bios.dts_magic);
-        module.append(DTS_LONG_PART3);
-        QByteArray reversedKey;
-        for(unsigned int i = 0; i < DTS_KEY_LENGTH; i++)
-            reversedKey.append(bios.dts_key.at(DTS_KEY_LENGTH-1-i) ^ DTS_LONG_MASK[i]);
-        module.append(reversedKey);
-        module.append(DTS_LONG_PART4);
-    }
+    // Job is deleted after its run() has returned
+    pool.waitForDone();
+    ImageJob *finished = job;
+    job = 0;
 
-    // UUID
-    if (!bios.uuid_header.isEmpty())
-    {
-        module.append(bios.uuid_header);
-        module.append(bios.uuid);
-        module.append(bios.mac);
-    }
-
-    // MBSN
-    if (!bios.mbsn_header.isEmpty())
-    {
-        module.append(bios.mbsn_header);
-        module.append(bios.mbsn);
-        module.append('\x00');
-    }
+    progressBar->hide();
+    cancelButton->hide();
+    ui->centralWidget->setEnabled(true);
+    ui->statusBar->clearMessage();
 
-    // Replacing all modules
-    QByteArray newData = data;
-    QByteArray moduleVersion;
-    int moduleLength;
-    pos = data.indexOf(MODULE_HEADER);
-    while(pos != -1)
+    QFileInfo fileInfo = finished->fileInfo();
+    switch (finished->result())
     {
-        // Checking for BSA_ signature
-        if (data.mid(pos + MODULE_HEADER_BSA_OFFSET, MODULE_HEADER_BSA.length()) != MODULE_HEADER_BSA)
-        {
-            pos = data.indexOf(MODULE_HEADER, pos + MODULE_HEADER_LENGTH);
-            continue;
-        }
-        
-        // Reading module length
-        moduleLength = (data.at(pos + MODULE_LENGTH_OFFSET + 2) << 16) +
-                       (data.at(pos + MODULE_LENGTH_OFFSET + 1) << 8)  +
-                        data.at(pos + MODULE_LENGTH_OFFSET);
-        if (moduleLength - MODULE_HEADER_LENGTH < module.length())
+    case ImageJob::Done:
+        if (finished->type() == ImageJob::LoadJob)
         {
-            lastError = tr("FD44 module in output file is too small to insert all data.\n Please use another full BIOS backup or factory BIOS file.");
-            return QByteArray();
+            cache.save();
+            if (writeToUI(finished->bios()))
+                ui->statusBar->showMessage(tr("Loaded: %1").arg(fileInfo.fileName()));
+            ui->toClipboardButton->setEnabled(true);
         }
-        
-        // Checking module version
-        moduleVersion = data.mid(pos + MODULE_VERSION_OFFSET, MODULE_VERSION_LENGTH);
-        if (MODULE_VERSIONS.indexOf(moduleVersion) < 0)
-        {
-            lastError = tr("FD44 module version in output file is unknown.");
-            return QByteArray();
-        }
-        if (moduleVersion != bios.module_version)
-        {
-            lastError = tr("FD44 module version in output file differs from version in input file.");
-            return QByteArray();
-        }
-
-        // Replacing module data
-        pos += MODULE_HEADER_LENGTH;
-        newData.replace(pos, module.length(), module);
-        
-        // Inserting FF bytes to the end of the module
-        pos += module.length();
-        QByteArray ffs(moduleLength - MODULE_HEADER_LENGTH - module.length(), '\xFF');
-        newData.replace(pos, ffs.length(), ffs);
-        
-        // Going to the next module
-        pos = data.indexOf(MODULE_HEADER, pos);
-    }
-
-    // Replacing GbE MACs
-    if (bios.mac_type == GbE)
-    {
-        pos = newData.indexOf(GBE_HEADER);
-        int pos2 = newData.lastIndexOf(GBE_HEADER);
-        if (pos == -1)
-        {
-            lastError = tr("GbE region is set as MAC storage but not found in output file.");
-            return QByteArray();
-        }
-        newData.replace(pos + GBE_MAC_OFFSET - MAC_LENGTH, MAC_LENGTH, bios.mac);
-        newData.replace(pos2 + GBE_MAC_OFFSET - MAC_LENGTH, MAC_LENGTH, bios.mac);
+        else
+            ui->statusBar->showMessage(tr("Written: %1.bin").arg(fileInfo.completeBaseName()));
+        break;
+    case ImageJob::Canceled:
+        ui->statusBar->showMessage(tr("Canceled: %1").arg(fileInfo.fileName()));
+        break;
+    case ImageJob::ReadFailed:
+        ui->statusBar->showMessage(tr("Can't open file for reading. Check file permissions."));
+        break;
+    case ImageJob::ParseFailed:
+        cache.save();
+        if (finished->type() == ImageJob::LoadJob)
+            QMessageBox::critical(this, tr("Fatal error"), tr("Error parsing BIOS data.\n%1").arg(finished->errorString()));
+        else
+            QMessageBox::critical(this, tr("Fatal error"), tr("Error parsing output file.\n%1").arg(finished->errorString()));
+        break;
+    case ImageJob::WriteFailed:
+        ui->statusBar->showMessage(tr("Can't open file for writing. Check file permissions."));
+        break;
     }
 
-    return newData;
+    finished->deleteLater();
 }
 
 bool FD44Editor::writeToUI(bios_t bios)
@@ -658,7 +206,7 @@ bool FD44Editor::writeToUI(bios_t bios)
     switch (bios.state)
     {
     case ParseError:
-        QMessageBox::critical(this, tr("Fatal error"), tr("Error parsing BIOS data.\n%1").arg(lastError));
+        // Reported by caller together with parse status
         return false;
     case Empty:
         QMessageBox::information(this, tr("Loaded module is empty"), tr("Loaded module is empty.\nIt is normal, if you are opening BIOS file downloaded from asus.com\n"\
@@ -671,12 +219,12 @@ bool FD44Editor::writeToUI(bios_t bios)
         if (bios.mac_type == MacNotDetected)
         {
             bios.mac_type = UUID;
-            bios.mac_magic = QByteArray();
+            FD44Parser::setField(bios, MacMagicField, QByteArray());
         }
         if (bios.dts_type == DtsNotDetected)
         {
             bios.dts_type = None;
-            bios.dts_magic = QByteArray();
+            FD44Parser::setField(bios, DtsMagicField, QByteArray());
         }
         break;
     case Valid:
@@ -684,29 +232,17 @@ bool FD44Editor::writeToUI(bios_t bios)
     }
 
     // BIOS information
-    ui->mbEdit->setText(bios.motherboard_name);
-	ui->recoveryNameEdit->setText(bios.recovery_name);
-	ui->biosVersionEdit->setText(QString("%1%2").arg((int)bios.bios_version.at(0),2,10,QChar('0')).arg((int)bios.bios_version.at(1),2,10,QChar('0')));
-    ui->dateEdit->setText(bios.bios_date);
+    ui->mbEdit->setText(FD44Parser::field(bios, MotherboardNameField));
+	ui->recoveryNameEdit->setText(FD44Parser::field(bios, RecoveryNameField));
+	ui->biosVersionEdit->setText(FD44Parser::biosVersionString(bios));
+    ui->dateEdit->setText(FD44Parser::field(bios, BiosDateField));
 
     // ME version
-    if (!bios.me_version.isEmpty())
+    if (FD44Parser::hasField(bios, MeVersionField))
     {
-        if (bios.me_version.length() == ME_VERSION_LENGTH)
-        {
-            qint16 major =  *(qint16*)(const void*)(bios.me_version.mid(0, 2));
-            qint16 minor =  *(qint16*)(const void*)(bios.me_version.mid(2, 2));
-            qint16 bugfix = *(qint16*)(const void*)(bios.me_version.mid(4, 2));
-            qint16 build =  *(qint16*)(const void*)(bios.me_version.mid(6, 2));
-            QString me;
-			if (bios.me_type == ME_5M)
-				me = "5M";
-			else if (bios.me_type == ME_3M)
-				me = "3M";
-			else
-				me = "1.5M";
-			ui->meVersionEdit->setText(QString("%1.%2.%3.%4 (%5)").arg(major).arg(minor).arg(bugfix).arg(build).arg(me));
-        }
+        QString me = FD44Parser::meVersionString(bios);
+        if (!me.isEmpty())
+            ui->meVersionEdit->setText(QString("%1 (%2)").arg(me).arg(FD44Parser::meTypeString(bios)));
         else
             ui->meVersionEdit->setText(tr("Not detected"));
     }
@@ -714,13 +250,8 @@ bool FD44Editor::writeToUI(bios_t bios)
         ui->meVersionEdit->setText("Not present");
 
     // GbE version
-    if (!bios.gbe_version.isEmpty())
-    {
-        quint8 major = bios.gbe_version.at(1);
-        quint8 minor = bios.gbe_version.at(0) >> 4 & 0x0F;
-        //quint8 image_id = data.gbe.gbe_version.at(0) & 0x0F;
-        ui->gbeVersionEdit->setText(QString("%1.%2").arg(major).arg(minor));
-    }
+    if (FD44Parser::hasField(bios, GbeVersionField))
+        ui->gbeVersionEdit->setText(FD44Parser::gbeVersionString(bios));
     else
         ui->gbeVersionEdit->setText(tr("Not present"));
 
@@ -728,7 +259,7 @@ bool FD44Editor::writeToUI(bios_t bios)
     // MAC storage
     ui->macStorageComboBox->clear();
     ui->macStorageComboBox->addItem("System UUID only", UUID);
-    if (!bios.mac_header.isEmpty())
+    if (bios.mac_header != NoHeader)
         ui->macStorageComboBox->addItem("ASCII string and system UUID", ASCII);
     ui->macStorageComboBox->addItem("GbE region and system UUID", GbE);
 
@@ -736,9 +267,9 @@ bool FD44Editor::writeToUI(bios_t bios)
     ui->dtsTypeComboBox->setEnabled(true);
 	ui->dtsTypeComboBox->clear();
     ui->dtsTypeComboBox->addItem("None", None);
-    if (!bios.dts_short_header.isEmpty())
+    if (bios.dts_short_header != NoHeader)
         ui->dtsTypeComboBox->addItem("Short", Short);
-    if (!bios.dts_long_header.isEmpty())
+    if (bios.dts_long_header != NoHeader)
         ui->dtsTypeComboBox->addItem("Long", Long);
 	if (ui->dtsTypeComboBox->count() == 1)
 		ui->dtsTypeComboBox->setEnabled(false);
@@ -753,9 +284,9 @@ bool FD44Editor::writeToUI(bios_t bios)
         break;
     case ASCII:
         ui->macStorageComboBox->setCurrentIndex(ui->macStorageComboBox->findData(ASCII));
-        if (bios.mac_header == ASCII_MAC_HEADER_7_SERIES)
+        if (bios.mac_header == Header7Series)
         {
-            ui->macMagicEdit->setText(bios.mac_magic.toHex());
+            ui->macMagicEdit->setText(FD44Parser::field(bios, MacMagicField).toHex());
             ui->macMagicEdit->setEnabled(true);
         }
         else
@@ -770,10 +301,10 @@ bool FD44Editor::writeToUI(bios_t bios)
         ui->macMagicEdit->setEnabled(false);
         break;
     default:
-        QMessageBox::critical(this, tr("Fatal error"), tr("Undefined control path in MAC setup.\n%1").arg(lastError));
+        QMessageBox::critical(this, tr("Fatal error"), tr("Undefined control path in MAC setup."));
         return false;
     }
-    ui->macEdit->setText(bios.mac.toHex());
+    ui->macEdit->setText(FD44Parser::field(bios, MacField).toHex());
     ui->macEdit->setEnabled(true);
     ui->macStorageComboBox->setEnabled(true);
 
@@ -784,39 +315,39 @@ bool FD44Editor::writeToUI(bios_t bios)
         ui->dtsKeyEdit->setText("");
         ui->dtsKeyEdit->setEnabled(false);
         ui->dtsTypeComboBox->setCurrentIndex(ui->macStorageComboBox->findData(None));
-        ui->dtsMagicComboBox->setCurrentIndex(ui->macStorageComboBox->findData(DTS_LONG_MAGIC_V1));
+        ui->dtsMagicComboBox->setCurrentIndex(ui->macStorageComboBox->findData(toByteArray(DTS_LONG_MAGIC_V1)));
         ui->dtsMagicComboBox->setEnabled(false);
         break;
     case Short:
-        ui->dtsKeyEdit->setText(bios.dts_key.toHex());
+        ui->dtsKeyEdit->setText(FD44Parser::field(bios, DtsKeyField).toHex());
         ui->dtsKeyEdit->setEnabled(true);
         ui->dtsTypeComboBox->setCurrentIndex(ui->macStorageComboBox->findData(Short));
-        ui->dtsMagicComboBox->setCurrentIndex(ui->macStorageComboBox->findData(DTS_LONG_MAGIC_V1));
+        ui->dtsMagicComboBox->setCurrentIndex(ui->macStorageComboBox->findData(toByteArray(DTS_LONG_MAGIC_V1)));
         ui->dtsMagicComboBox->setEnabled(false);
         break;
     case Long:
-        ui->dtsKeyEdit->setText(bios.dts_key.toHex());
+        ui->dtsKeyEdit->setText(FD44Parser::field(bios, DtsKeyField).toHex());
         ui->dtsKeyEdit->setEnabled(true);
         ui->dtsTypeComboBox->setCurrentIndex(ui->macStorageComboBox->findData(Long));
-        ui->dtsMagicComboBox->setCurrentIndex(ui->dtsMagicComboBox->findData(bios.dts_magic));
+        ui->dtsMagicComboBox->setCurrentIndex(ui->dtsMagicComboBox->findData(FD44Parser::field(bios, DtsMagicField)));
         ui->dtsMagicComboBox->setEnabled(true);
         break;
     default:
-        QMessageBox::critical(this, tr("Fatal error"), tr("Undefined control path in DTS key setup.\n%1").arg(lastError));
+        QMessageBox::critical(this, tr("Fatal error"), tr("Undefined control path in DTS key setup."));
         return false;
     }
 
     // UUID
-    if (!bios.uuid_header.isEmpty())
+    if (bios.uuid_header != NoHeader)
     {
-        ui->uuidEdit->setText(bios.uuid.toHex());
+        ui->uuidEdit->setText(FD44Parser::field(bios, UuidField).toHex());
         ui->uuidEdit->setEnabled(true);
     }
 
     // MBSN
-    if (!bios.mbsn_header.isEmpty())
+    if (bios.mbsn_header != NoHeader)
     {
-        ui->mbsnEdit->setText(bios.mbsn);
+        ui->mbsnEdit->setText(FD44Parser::field(bios, MbsnField));
         ui->mbsnEdit->setEnabled(true);
     }
     
@@ -828,14 +359,14 @@ bios_t FD44Editor::readFromUI()
 {
     bios_t bios = opened;
 
-    bios.mac = QByteArray::fromHex(ui->macEdit->text().toLatin1());
-    bios.uuid = QByteArray::fromHex(ui->uuidEdit->text().toLatin1());
-    bios.dts_key = QByteArray::fromHex(ui->dtsKeyEdit->text().toLatin1());
-    bios.mbsn = ui->mbsnEdit->text().toLatin1();
+    FD44Parser::setField(bios, MacField, QByteArray::fromHex(ui->macEdit->text().toLatin1()));
+    FD44Parser::setField(bios, UuidField, QByteArray::fromHex(ui->uuidEdit->text().toLatin1()));
+    FD44Parser::setField(bios, DtsKeyField, QByteArray::fromHex(ui->dtsKeyEdit->text().toLatin1()));
+    FD44Parser::setField(bios, MbsnField, ui->mbsnEdit->text().toLatin1());
     bios.mac_type = (mac_e)ui->macStorageComboBox->itemData(ui->macStorageComboBox->currentIndex()).toInt();
-    bios.mac_magic = QByteArray::fromHex(ui->macMagicEdit->text().toLatin1());
+    FD44Parser::setField(bios, MacMagicField, QByteArray::fromHex(ui->macMagicEdit->text().toLatin1()));
     bios.dts_type = (dts_e)ui->dtsTypeComboBox->itemData(ui->dtsTypeComboBox->currentIndex()).toInt();
-    bios.dts_magic = ui->dtsMagicComboBox->itemData(ui->dtsMagicComboBox->currentIndex()).toByteArray();
+    FD44Parser::setField(bios, DtsMagicField, ui->dtsMagicComboBox->itemData(ui->dtsMagicComboBox->currentIndex()).toByteArray());
     
     return bios;
 }
@@ -866,7 +397,7 @@ void FD44Editor::enableDtsKeyEdit(int index)
 
 void FD44Editor::enableMacMagicEdit(int index)
 {
-    if (ui->macStorageComboBox->itemData(index) == ASCII && opened.mac_header == ASCII_MAC_HEADER_7_SERIES)
+    if (ui->macStorageComboBox->itemData(index) == ASCII && opened.mac_header == Header7Series)
        ui->macMagicEdit->setEnabled(true);
     else
         ui->macMagicEdit->setEnabled(false);
@@ -878,7 +409,7 @@ void FD44Editor::enableDtsMagicCombobox(int index)
 {
     if (ui->dtsTypeComboBox->itemData(index) == Long)
     {
-        ui->dtsMagicComboBox->setCurrentIndex(ui->dtsMagicComboBox->findData(opened.dts_magic.isEmpty() ? DTS_LONG_MAGIC_V1 : opened.dts_magic));
+        ui->dtsMagicComboBox->setCurrentIndex(ui->dtsMagicComboBox->findData(FD44Parser::hasField(opened, DtsMagicField) ? FD44Parser::field(opened, DtsMagicField) : toByteArray(DTS_LONG_MAGIC_V1)));
         ui->dtsMagicComboBox->setEnabled(true);
     }
     else
@@ -894,8 +425,40 @@ void FD44Editor::dragEnterEvent(QDragEnterEvent* event)
 
 void FD44Editor::dropEvent(QDropEvent* event)
 {
-    QString path = event->mimeData()->urls().at(0).toLocalFile();
-    openImageFile(path);
+    QStringList paths;
+    QList<QUrl> urls = event->mimeData()->urls();
+    for (int i = 0; i < urls.size(); i++)
+        if (!urls.at(i).toLocalFile().isEmpty())
+            paths.append(urls.at(i).toLocalFile());
+    if (paths.isEmpty())
+        return;
+
+    // Single file is opened, several files and folders are listed
+    if (paths.size() == 1 && !QFileInfo(paths.at(0)).isDir())
+    {
+        if (!job)
+            openImageFile(paths.at(0));
+        return;
+    }
+
+    listModel->addFiles(paths);
+    listDock->show();
+    if (!job)
+        ui->statusBar->showMessage(tr("Parsing dropped files..."));
+}
+
+void FD44Editor::listFinished()
+{
+    cache.save();
+    if (!job)
+        ui->statusBar->showMessage(tr("Listed: %1 images").arg(listModel->rowCount()));
+}
+
+void FD44Editor::openListedImage(const QModelIndex & index)
+{
+    // Listed file is already parsed, so it is taken from cache
+    if (!job)
+        openImageFile(listModel->path(listProxy->mapToSource(index).row()));
 }
 
 void FD44Editor::copyToClipboard()
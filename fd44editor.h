@@ -17,6 +17,7 @@
 #include <QMainWindow>
 #include <QByteArray>
 #include <QClipboard>
+#include <QDockWidget>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QFile>
@@ -24,9 +25,17 @@
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSortFilterProxyModel>
+#include <QTableView>
+#include <QThreadPool>
 #include <QUrl>
 
-#include "motherboards.h"
+#include "fd44parser.h"
+#include "imagecache.h"
+#include "imagejob.h"
+#include "imagelistmodel.h"
 
 namespace Ui {
 class FD44Editor;
@@ -50,14 +59,25 @@ private slots:
     void enableMacMagicEdit(int index);
     void enableDtsMagicCombobox(int index);
 	void copyToClipboard();
+    void jobFinished();
+    void listFinished();
+    void openListedImage(const QModelIndex & index);
 
 private:
     Ui::FD44Editor *ui;
-    QString lastError;
     bios_t opened;
+    ImageCache cache;
+    QThreadPool pool;
+    ImageJob *job;
+    QProgressBar *progressBar;
+    QPushButton *cancelButton;
+    QDockWidget *listDock;
+    QTableView *listView;
+    ImageListModel *listModel;
+    QSortFilterProxyModel *listProxy;
 
-    bios_t readFromBIOS(const QByteArray & data);
-    QByteArray writeToBIOS(const QByteArray & data, const bios_t & bios);
+    // Runs one job at a time, window is disabled until it is finished
+    void startJob(ImageJob *newJob);
 
     bios_t readFromUI();
     bool writeToUI(bios_t bios);
@@ -0,0 +1,214 @@
+/* fd44parser.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "fd44parser.h"
+
+static ByteView view(const QByteArray & data)
+{
+    return ByteView(data.constData(), data.size());
+}
+
+int FD44Parser::capsuleOffset(const QByteArray & data)
+{
+    return FD44Image::capsuleOffset(view(data));
+}
+
+image_status_t FD44Parser::readFromBIOS(const QByteArray & data, bios_t & bios)
+{
+    return FD44Image::read(view(data), bios);
+}
+
+image_status_t FD44Parser::writeToBIOS(const QByteArray & data, const bios_t & bios, QByteArray & newData)
+{
+    QList<patch_t> patches;
+    image_status_t status = buildPatches(data, bios, patches);
+    if (status.error == NoError)
+        newData = applyPatches(data, patches);
+    return status;
+}
+
+QByteArray FD44Parser::applyPatches(const QByteArray & data, const QList<patch_t> & patches)
+{
+    // Deep copy, input data can be a view of mapped file
+    QByteArray newData(data.constData(), data.size());
+    for (int i = 0; i < patches.size(); i++)
+        newData.replace(patches.at(i).offset, patches.at(i).data.size(), patches.at(i).data);
+
+    return newData;
+}
+
+// Copies patches returned by FD44Image to Qt containers
+static void toPatches(const std::vector<image_patch_t> & imagePatches, QList<patch_t> & patches)
+{
+    for (size_t i = 0; i < imagePatches.size(); i++)
+    {
+        patch_t patch;
+        patch.offset = imagePatches[i].offset;
+        patch.data = QByteArray((const char*)imagePatches[i].data.data(), (int)imagePatches[i].data.size());
+        patches.append(patch);
+    }
+}
+
+image_status_t FD44Parser::buildPatches(const QByteArray & data, const bios_t & bios, QList<patch_t> & patches)
+{
+    patches.clear();
+
+    std::vector<image_patch_t> imagePatches;
+    image_status_t status = FD44Image::buildPatches(view(data), bios, imagePatches);
+    if (status.error == NoError)
+        toPatches(imagePatches, patches);
+    return status;
+}
+
+image_status_t FD44Parser::buildLayout(const QByteArray & data, const bios_t & bios, patch_layout_t & layout)
+{
+    return FD44Image::buildLayout(view(data), bios, layout);
+}
+
+image_status_t FD44Parser::layoutPatches(const QByteArray & data, const patch_layout_t & layout, const bios_t & bios, QList<patch_t> & patches)
+{
+    patches.clear();
+
+    std::vector<image_patch_t> imagePatches;
+    image_status_t status = FD44Image::layoutPatches(view(data), layout, bios, imagePatches);
+    if (status.error == NoError)
+        toPatches(imagePatches, patches);
+    return status;
+}
+
+static QString hexOffset(int offset)
+{
+    return QString("0x%1").arg(QString::number(offset, 16).toUpper());
+}
+
+QString FD44Parser::errorString(const image_status_t & status, const QByteArray & data, const bios_t & bios)
+{
+    QString offset = hexOffset(status.offset);
+    switch (status.error)
+    {
+    case NoError:
+        return QString();
+    case BootefiNotFound:
+        return tr("$BOOTEFI$ signature not found.\nPlease open correct ASUS BIOS file.");
+    case ModuleNotFound:
+        return tr("FD44 module not found.");
+    case ModuleVersionUnknown:
+        return tr("FD44 module version at %1 is unknown.").arg(offset);
+    case ModuleVersionUnsupported:
+        return tr("No valid structure setup path for module version at %1.").arg(offset);
+    case ShortDtsPart2Unknown:
+        return tr("Part 2 of short DTS key is unknown at %1.").arg(offset);
+    case LongDtsPart2Unknown:
+        return tr("Part 2 of long DTS key is unknown at %1.").arg(offset);
+    case LongDtsPart3Unknown:
+        return tr("Part 3 of long DTS key is unknown at %1.").arg(offset);
+    case LongDtsKeyCorrupted:
+        return tr("Long DTS key reversed bytes section is corrupted at %1.").arg(offset);
+    case LongDtsPart4Unknown:
+        return tr("Part 4 of long DTS header is unknown at %1.").arg(offset);
+    case UuidNotFound:
+        return tr("System UUID required but not found in module body at %1.").arg(offset);
+    case MbsnNotFound:
+        return tr("Motherboard S/N required but not found in module body at %1.").arg(offset);
+    case OutputBootefiNotFound:
+        return tr("$BOOTEFI$ signature not found in output file.\nPlease open correct ASUS BIOS file.");
+    case OutputModuleNotFound:
+        return tr("FD44 module not found in output file.");
+    case OutputMotherboardDiffers:
+        return tr("Motherboard model in in output file differs from model in loaded data.\n"\
+                  "Loaded: %1\n"\
+                  "File: %2")
+                  .arg(QString(field(bios, MotherboardNameField)))
+                  .arg(QString(data.mid(status.offset, BOOTEFI_MOTHERBOARD_NAME_LENGTH)));
+    case OutputModuleTooSmall:
+        return tr("FD44 module at %1 in output file is too small to insert all data.\n Please use another full BIOS backup or factory BIOS file.").arg(offset);
+    case OutputModuleVersionUnknown:
+        return tr("FD44 module version at %1 in output file is unknown.").arg(offset);
+    case OutputModuleVersionDiffers:
+        return tr("FD44 module version at %1 in output file differs from version in input file.").arg(offset);
+    case OutputModuleTruncated:
+        return tr("FD44 module at %1 in output file is truncated.").arg(offset);
+    case OutputGbeNotFound:
+        return tr("GbE region is set as MAC storage but not found in output file.");
+    }
+    return QString();
+}
+
+QString FD44Parser::biosVersionString(const bios_t & bios)
+{
+    if (!hasField(bios, BiosVersionField))
+        return QString();
+
+    return QString("%1%2").arg((int)bios.bios_version[0],2,10,QChar('0')).arg((int)bios.bios_version[1],2,10,QChar('0'));
+}
+
+QString FD44Parser::meVersionString(const bios_t & bios)
+{
+    if (!hasField(bios, MeVersionField))
+        return QString();
+
+    // Little-endian 16-bit words
+    const uint8_t *version = bios.me_version;
+    qint16 major =  (qint16)(version[0] | version[1] << 8);
+    qint16 minor =  (qint16)(version[2] | version[3] << 8);
+    qint16 bugfix = (qint16)(version[4] | version[5] << 8);
+    qint16 build =  (qint16)(version[6] | version[7] << 8);
+    return QString("%1.%2.%3.%4").arg(major).arg(minor).arg(bugfix).arg(build);
+}
+
+QString FD44Parser::meTypeString(const bios_t & bios)
+{
+    if (bios.me_type == ME_5M)
+        return "5M";
+    else if (bios.me_type == ME_3M)
+        return "3M";
+    else
+        return "1.5M";
+}
+
+QString FD44Parser::gbeVersionString(const bios_t & bios)
+{
+    if (!hasField(bios, GbeVersionField))
+        return QString();
+
+    quint8 major = bios.gbe_version[1];
+    quint8 minor = bios.gbe_version[0] >> 4 & 0x0F;
+    //quint8 image_id = data.gbe.gbe_version.at(0) & 0x0F;
+    return QString("%1.%2").arg(major).arg(minor);
+}
+
+bool FD44Parser::hasField(const bios_t & bios, bios_field_e field)
+{
+    return FD44Image::hasField(bios, field);
+}
+
+QByteArray FD44Parser::field(const bios_t & bios, bios_field_e field)
+{
+    ByteView bytes = FD44Image::field(bios, field);
+    return QByteArray(bytes.data(), bytes.size());
+}
+
+bool FD44Parser::setField(bios_t & bios, bios_field_e field, const QByteArray & value)
+{
+    return FD44Image::setField(bios, field, view(value));
+}
+
+QString FD44Parser::fieldText(const QByteArray & field)
+{
+    return QString::fromLatin1(field.constData(), qstrnlen(field.constData(), field.size())).trimmed();
+}
+
+QString FD44Parser::fieldHex(const QByteArray & field)
+{
+    return QString(field.toHex().toUpper());
+}
@@ -0,0 +1,86 @@
+/* fd44parser.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef FD44PARSER_H
+#define FD44PARSER_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+
+#include "fd44image.h"
+
+// Replaced byte range of image
+typedef struct {
+    int offset;
+    QByteArray data;
+} patch_t;
+
+// QByteArray referencing constant byte array, no copy is made
+template <size_t N> inline QByteArray toByteArray(const std::array<uint8_t, N> & bytes)
+{
+    return QByteArray::fromRawData((const char*)bytes.data(), N);
+}
+
+// Qt interface to FD44Image, shared by GUI and command-line tool.
+// Depends on QtCore only, no QApplication instance is required.
+// Parser has no state, all results are returned to caller,
+// so it can be used from any number of threads at once.
+class FD44Parser
+{
+    Q_DECLARE_TR_FUNCTIONS(FD44Parser)
+
+public:
+    static image_status_t readFromBIOS(const QByteArray & data, bios_t & bios);
+    static image_status_t writeToBIOS(const QByteArray & data, const bios_t & bios, QByteArray & newData);
+
+    // Computes byte ranges changed by writeToBIOS without copying the image:
+    // body of every FD44 module with its FF tail and both GbE MAC slots.
+    // Ranges that already hold new bytes are omitted.
+    static image_status_t buildPatches(const QByteArray & data, const bios_t & bios, QList<patch_t> & patches);
+    static QByteArray applyPatches(const QByteArray & data, const QList<patch_t> & patches);
+
+    // Batch writing: layout is found once for image and bios field types, then patches
+    // for every bios with the same types are computed without searching image
+    static image_status_t buildLayout(const QByteArray & data, const bios_t & bios, patch_layout_t & layout);
+    static image_status_t layoutPatches(const QByteArray & data, const patch_layout_t & layout, const bios_t & bios, QList<patch_t> & patches);
+
+    // Returns size of AMI Aptio capsule header, 0 if there is none
+    static int capsuleOffset(const QByteArray & data);
+
+    // Human-readable representations of version fields,
+    // empty string is returned for missing or truncated fields
+    static QString biosVersionString(const bios_t & bios);
+    static QString meVersionString(const bios_t & bios);
+    static QString meTypeString(const bios_t & bios);
+    static QString gbeVersionString(const bios_t & bios);
+
+    // Conversion of fixed-size bios_t fields to byte arrays and back.
+    // Empty array is returned for missing field, setting empty array removes field.
+    // Text fields are returned up to terminating zero and can be set shorter.
+    static bool hasField(const bios_t & bios, bios_field_e field);
+    static QByteArray field(const bios_t & bios, bios_field_e field);
+    static bool setField(bios_t & bios, bios_field_e field, const QByteArray & value);
+
+    // Field value for display: text up to terminating zero without
+    // surrounding spaces, binary as upper-case hex digits
+    static QString fieldText(const QByteArray & field);
+    static QString fieldHex(const QByteArray & field);
+
+    // Translated message for status returned by read or write call on the same data,
+    // empty string is returned for NoError
+    static QString errorString(const image_status_t & status, const QByteArray & data, const bios_t & bios);
+};
+
+#endif // FD44PARSER_H
@@ -0,0 +1,293 @@
+/* fd44gen.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+// Synthetic BIOS image generator.
+// Writes images for benchmarks and regression tests without vendor ROMs,
+// values written to every image are printed in fd44 info format.
+
+#include <stdio.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "imagegenerator.h"
+#include "imagewriter.h"
+
+static int usage()
+{
+    QTextStream err(stderr);
+    err << "Usage: fd44gen <image> [options]\n"
+           "       fd44gen --matrix <directory> [options]\n"
+           "\n"
+           "Options:\n"
+           "  --size <MB>             image size in megabytes, 8 by default\n"
+           "  --descriptor            full flash dump with Intel flash descriptor\n"
+           "  --layout <layout>       6series, x79, c20x, c602, 7series or 9series\n"
+           "  --me <type>             none, 1.5m, 3m or 5m\n"
+           "  --gbe <count>           number of GbE regions: 0, 1 or 2\n"
+           "  --mac-type <type>       MAC storage: uuid, ascii or gbe\n"
+           "  --dts-type <type>       DTS key type: none, short or long\n"
+           "  --dts-magic <1|2|3>     long DTS key magic variant\n"
+           "  --modules <count>       number of identical FD44 modules\n"
+           "  --volume                place modules into UEFI firmware volume\n"
+           "  --module-size <bytes>   module length including header\n"
+           "  --module-padding <bytes> random bytes in module body before data\n"
+           "  --empty                 write empty 0xFF modules\n"
+           "  --decoys <count>        near-miss signature copies per megabyte\n"
+           "  --seed <number>         random data and field values\n"
+           "\n"
+           "MAC storage and DTS key type default to the most complete ones supported by layout.\n"
+           "Matrix mode writes every layout, MAC storage, DTS key and ME type combination\n"
+           "and tab-separated expected.tsv with values written to each image.\n";
+    return 1;
+}
+
+static int fail(const QString & message)
+{
+    QTextStream err(stderr);
+    err << "fd44gen: " << message << "\n";
+    return 2;
+}
+
+// Picks most complete MAC storage and DTS key supported by layout and GbE count
+static void setDefaults(generator_options_t & options, bool macSet, bool dtsSet)
+{
+    if (!macSet)
+    {
+        options.mac_type = (options.gbe_count > 0) ? GbE : ASCII;
+        if (!ImageGenerator::validate(options).isEmpty())
+            options.mac_type = UUID;
+    }
+    if (!dtsSet)
+    {
+        const dts_e types[] = {Long, Short, None};
+        for (int i = 0; i < 3; i++)
+        {
+            options.dts_type = types[i];
+            if (ImageGenerator::validate(options).isEmpty())
+                break;
+        }
+    }
+}
+
+static bool writeImage(const QString & path, const generator_options_t & options)
+{
+    return ImageWriter::write(path, ImageGenerator::generate(options));
+}
+
+static int single(const QString & path, const generator_options_t & options)
+{
+    if (!writeImage(path, options))
+        return fail(QString("can't write %1").arg(path));
+
+    QTextStream out(stdout);
+    QStringList keys = ImageGenerator::expectedKeys();
+    QStringList values = ImageGenerator::expectedValues(options);
+    for (int i = 0; i < keys.size(); i++)
+        out << keys.at(i) << "=" << values.at(i) << "\n";
+    return 0;
+}
+
+static int matrix(const QString & path, const generator_options_t & base)
+{
+    static const char* macNames[] = {"uuid", "ascii", "gbe"};
+    static const char* dtsNames[] = {"none", "short", "long"};
+    static const char* meNames[] = {"nome", "me15m", "me3m", "me5m"};
+
+    if (!QDir().mkpath(path))
+        return fail(QString("can't create %1").arg(path));
+
+    QFile expected(QDir(path).filePath("expected.tsv"));
+    if (!expected.open(QFile::WriteOnly | QFile::Truncate))
+        return fail(QString("can't write %1").arg(expected.fileName()));
+    QTextStream out(&expected);
+    out << "path\t" << ImageGenerator::expectedKeys().join("\t") << "\n";
+
+    // ME type and seed change with every image, so all ME types are covered
+    // and no two images share field values
+    int count = 0;
+    for (int layout = 0; layout < LayoutCount; layout++)
+    {
+        for (int mac = UUID; mac <= GbE; mac++)
+        {
+            for (int dts = None; dts <= Long; dts++)
+            {
+                for (int magic = 1; magic <= (dts == Long ? 3 : 1); magic++)
+                {
+                    for (int empty = 0; empty <= 1; empty++)
+                    {
+                        generator_options_t options = base;
+                        options.layout = (layout_e)layout;
+                        options.mac_type = (mac_e)mac;
+                        options.gbe_count = (mac == GbE) ? 1 + count % 2 : 0;
+                        options.dts_type = (dts_e)dts;
+                        options.dts_magic = magic;
+                        options.empty_module = (empty != 0);
+                        options.me = (generator_me_e)(count % 4);
+                        options.seed = base.seed + count;
+                        if (!ImageGenerator::validate(options).isEmpty())
+                            continue;
+
+                        QString name = QString("%1-%2-%3%4-%5%6.rom")
+                                       .arg(ImageGenerator::layoutName(options.layout))
+                                       .arg(macNames[mac]).arg(dtsNames[dts])
+                                       .arg(dts == Long ? QString::number(magic) : QString())
+                                       .arg(meNames[options.me])
+                                       .arg(empty ? "-empty" : "");
+                        QString imagePath = QDir(path).filePath(name);
+                        if (!writeImage(imagePath, options))
+                            return fail(QString("can't write %1").arg(imagePath));
+
+                        out << imagePath << "\t" << ImageGenerator::expectedValues(options).join("\t") << "\n";
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+
+    QTextStream(stdout) << "images=" << count << "\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for (int i = 1; i < argc; i++)
+        args.append(QString::fromLocal8Bit(argv[i]));
+
+    generator_options_t options = ImageGenerator::defaultOptions();
+    QString path;
+    bool matrixMode = false, macSet = false, dtsSet = false;
+
+    for (int i = 0; i < args.size(); i++)
+    {
+        const QString & arg = args.at(i);
+        if (arg == "--empty")
+        {
+            options.empty_module = true;
+            continue;
+        }
+        if (arg == "--descriptor")
+        {
+            options.descriptor = true;
+            continue;
+        }
+        if (arg == "--volume")
+        {
+            options.volume = true;
+            continue;
+        }
+        if (arg == "--matrix")
+        {
+            matrixMode = true;
+            continue;
+        }
+        if (!arg.startsWith('-'))
+        {
+            if (!path.isEmpty())
+                return usage();
+            path = arg;
+            continue;
+        }
+
+        if (i + 1 >= args.size())
+            return usage();
+        const QString & value = args.at(++i);
+        bool ok = true;
+
+        if (arg == "--size")
+            options.size = value.toInt(&ok) * 1024 * 1024;
+        else if (arg == "--layout")
+        {
+            int layout = 0;
+            while (layout < LayoutCount && value != ImageGenerator::layoutName((layout_e)layout))
+                layout++;
+            ok = (layout < LayoutCount);
+            options.layout = (layout_e)layout;
+        }
+        else if (arg == "--me")
+        {
+            if (value == "none")
+                options.me = NoMe;
+            else if (value == "1.5m")
+                options.me = Me15M;
+            else if (value == "3m")
+                options.me = Me3M;
+            else if (value == "5m")
+                options.me = Me5M;
+            else
+                ok = false;
+        }
+        else if (arg == "--gbe")
+            options.gbe_count = value.toInt(&ok);
+        else if (arg == "--mac-type")
+        {
+            macSet = true;
+            if (value == "uuid")
+                options.mac_type = UUID;
+            else if (value == "ascii")
+                options.mac_type = ASCII;
+            else if (value == "gbe")
+                options.mac_type = GbE;
+            else
+                ok = false;
+        }
+        else if (arg == "--dts-type")
+        {
+            dtsSet = true;
+            if (value == "none")
+                options.dts_type = None;
+            else if (value == "short")
+                options.dts_type = Short;
+            else if (value == "long")
+                options.dts_type = Long;
+            else
+                ok = false;
+        }
+        else if (arg == "--dts-magic")
+            options.dts_magic = value.toInt(&ok);
+        else if (arg == "--modules")
+            options.module_count = value.toInt(&ok);
+        else if (arg == "--module-size")
+            options.module_size = value.toInt(&ok, 0);
+        else if (arg == "--module-padding")
+            options.module_padding = value.toInt(&ok, 0);
+        else if (arg == "--decoys")
+            options.decoys_per_mb = value.toInt(&ok);
+        else if (arg == "--seed")
+            options.seed = value.toUInt(&ok, 0);
+        else
+            return usage();
+
+        if (!ok)
+            return fail(QString("invalid value %1 of %2").arg(value).arg(arg));
+    }
+
+    if (path.isEmpty())
+        return usage();
+
+    if (matrixMode)
+        return matrix(path, options);
+
+    setDefaults(options, macSet, dtsSet);
+    QString error = ImageGenerator::validate(options);
+    if (!error.isEmpty())
+        return fail(error);
+
+    return single(path, options);
+}
@@ -0,0 +1,12 @@
+QT       = core
+
+TARGET = fd44gen
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES += fd44gen.cpp
+
+include(../fd44core.pri)
+include(imagegenerator.pri)
@@ -0,0 +1,478 @@
+/* imagegenerator.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <string.h>
+
+#include "descriptor.h"
+#include "imagegenerator.h"
+#include "mefpt.h"
+#include "volume.h"
+
+// Fixed image structure offsets, descriptor regions are
+// descriptor [0, ME_OFFSET), ME [ME_OFFSET, GBE_OFFSET), GbE [GBE_OFFSET, STRUCTURES_END), BIOS up to the end
+#define FRBA_OFFSET             0x40
+#define ME_OFFSET               0x1000
+#define ME_PARTITION_SIZE       0x1000
+#define GBE_OFFSET              0x6000
+#define GBE_REGION_SIZE         0x1000
+#define STRUCTURES_END          0x8000
+#define BOOTEFI_FROM_END        0x1000
+#define MODULES_FROM_MIDDLE     0x100
+
+// Firmware volume holding modules starts in the middle of image,
+// pad file fills space between volume header and first module
+#define FV_HEADER_SIZE          0x48
+#define FV_BLOCK_SIZE           0x1000
+#define FFS_PAD_FILE_TYPE       0xF0
+#define FFS_TYPE_OFFSET         18
+
+// Board name and header set of every layout, as detected by parser
+typedef struct {
+    const char *name;
+    const char *board;
+    int version_index;
+    header_e mac_header;
+    header_e dts_short_header;
+    header_e dts_long_header;
+    header_e uuid_header;
+    header_e mbsn_header;
+} layout_t;
+
+static const layout_t LAYOUTS[LayoutCount] = {
+    {"6series", "P8P67-PRO", 0, Header6Series, Header6Series, Header6Series, Header6Series, Header6Series},
+    {"x79",     "P9X79",     0, NoHeader,      NoHeader,      HeaderX79,     HeaderX79,     HeaderX79},
+    {"c20x",    "P8B-E-4L",  0, NoHeader,      NoHeader,      NoHeader,      Header7Series, Header7Series},
+    {"c602",    "Z9PE-D16",  1, NoHeader,      NoHeader,      NoHeader,      Header7Series, Header7Series},
+    {"7series", "P8Z77-V",   2, Header7Series, NoHeader,      Header7Series, Header7Series, Header7Series},
+    {"9series", "Z97-A",     3, Header7Series, NoHeader,      NoHeader,      Header7Series, Header7Series},
+};
+
+// Field values, derived from seed
+typedef struct {
+    char mac[MAC_LENGTH];
+    char mac_magic;
+    char uuid[UUID_LENGTH - MAC_LENGTH];
+    char dts_key[DTS_KEY_LENGTH];
+    char mbsn[MBSN_BODY_LENGTH - 1];
+} values_t;
+
+// Xorshift generator, independent of rand() state
+static quint32 nextRandom(quint32 & state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static quint32 initRandom(quint32 seed, quint32 stream)
+{
+    quint32 state = seed * 2654435761u ^ stream;
+    return state ? state : 0xFD44;
+}
+
+static values_t generateValues(quint32 seed)
+{
+    static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    quint32 state = initRandom(seed, 0x56414C53);
+    values_t values;
+
+    for (int i = 0; i < MAC_LENGTH; i++)
+        values.mac[i] = (char)nextRandom(state);
+    // Unicast address
+    values.mac[0] &= (char)0xFE;
+    values.mac_magic = (char)(nextRandom(state) | 0x01);
+    for (int i = 0; i < UUID_LENGTH - MAC_LENGTH; i++)
+        values.uuid[i] = (char)nextRandom(state);
+    for (int i = 0; i < DTS_KEY_LENGTH; i++)
+        values.dts_key[i] = (char)nextRandom(state);
+    values.mbsn[0] = 'M';
+    values.mbsn[1] = 'T';
+    for (int i = 2; i < MBSN_BODY_LENGTH - 1; i++)
+        values.mbsn[i] = alphabet[nextRandom(state) % (sizeof(alphabet) - 1)];
+    return values;
+}
+
+template <size_t N> static QByteArray bytes(const std::array<uint8_t, N> & signature)
+{
+    return QByteArray((const char*)signature.data(), N);
+}
+
+static QByteArray header(header_e variant, const QByteArray & series6, const QByteArray & series7, const QByteArray & x79)
+{
+    switch (variant)
+    {
+    case Header6Series:
+        return series6;
+    case Header7Series:
+        return series7;
+    case HeaderX79:
+        return x79;
+    default:
+        return QByteArray();
+    }
+}
+
+static void put(QByteArray & image, int pos, const QByteArray & data)
+{
+    memcpy(image.data() + pos, data.constData(), data.size());
+}
+
+static void putUint32(QByteArray & image, int pos, quint32 value)
+{
+    for (int i = 0; i < 4; i++)
+        image[pos + i] = (char)(value >> (8 * i) & 0xFF);
+}
+
+static void putUint16(QByteArray & image, int pos, quint16 value)
+{
+    image[pos] = (char)(value & 0xFF);
+    image[pos + 1] = (char)(value >> 8);
+}
+
+// Firmware volume header with single block map entry and zero checksum
+static void putVolumeHeader(QByteArray & image, int pos, int length)
+{
+    static const char fileSystemGuid[] = "\x78\xE5\x8C\x8C\x3D\x8A\x1C\x4F\x99\x35\x89\x61\x85\xC3\x2D\xD3";
+    memset(image.data() + pos, 0, FV_HEADER_SIZE);
+    memcpy(image.data() + pos + 16, fileSystemGuid, 16);
+    putUint32(image, pos + FV_LENGTH_OFFSET, length);
+    put(image, pos + FV_SIGNATURE_OFFSET, bytes(FV_SIGNATURE));
+    putUint32(image, pos + FV_SIGNATURE_OFFSET + 4, 0x0004FEFF);
+    putUint16(image, pos + FV_HEADER_LENGTH_OFFSET, FV_HEADER_SIZE);
+    image[pos + 55] = 2;
+    putUint32(image, pos + 56, length / FV_BLOCK_SIZE);
+    putUint32(image, pos + 60, FV_BLOCK_SIZE);
+
+    quint16 sum = 0;
+    for (int i = 0; i < FV_HEADER_SIZE; i += 2)
+        sum += (quint16)((uchar)image.at(pos + i) | (uchar)image.at(pos + i + 1) << 8);
+    putUint16(image, pos + 50, (quint16)(0x10000 - sum));
+}
+
+// FLREG value, unused region has base above limit
+static quint32 flashRegion(int start, int end)
+{
+    if (end <= start)
+        return 0x00007FFF;
+    return (quint32)(start / FLASH_REGION_GRANULARITY) | (quint32)((end - 1) / FLASH_REGION_GRANULARITY) << 16;
+}
+
+// Module data in the same order as written by FD44Image::buildPatches
+static QByteArray moduleData(const generator_options_t & options, const values_t & values)
+{
+    const layout_t & layout = LAYOUTS[options.layout];
+    QByteArray data;
+
+    if (options.mac_type == ASCII)
+    {
+        data += header(layout.mac_header, bytes(ASCII_MAC_HEADER_6_SERIES), bytes(ASCII_MAC_HEADER_7_SERIES), QByteArray());
+        if (layout.mac_header == Header7Series)
+        {
+            data += values.mac_magic;
+            data += '\0';
+        }
+        data += QByteArray(values.mac, MAC_LENGTH).toHex().toUpper();
+        data += '\0';
+    }
+
+    if (options.dts_type == Short)
+    {
+        data += header(layout.dts_short_header, bytes(DTS_SHORT_HEADER_6_SERIES), QByteArray(), QByteArray());
+        data += QByteArray(values.dts_key, DTS_KEY_LENGTH);
+        data += bytes(DTS_SHORT_PART2);
+    }
+
+    if (options.dts_type == Long)
+    {
+        const dts_magic_t magics[] = {DTS_LONG_MAGIC_V1, DTS_LONG_MAGIC_V2, DTS_LONG_MAGIC_V3};
+        data += header(layout.dts_long_header, bytes(DTS_LONG_HEADER_6_SERIES), bytes(DTS_LONG_HEADER_7_SERIES), bytes(DTS_LONG_HEADER_X79));
+        data += QByteArray(values.dts_key, DTS_KEY_LENGTH);
+        data += bytes(DTS_LONG_PART2);
+        data += bytes(magics[options.dts_magic - 1]);
+        data += bytes(DTS_LONG_PART3);
+        for (int i = 0; i < DTS_KEY_LENGTH; i++)
+            data += (char)(values.dts_key[DTS_KEY_LENGTH - 1 - i] ^ DTS_LONG_MASK[i]);
+        data += bytes(DTS_LONG_PART4);
+    }
+
+    data += header(layout.uuid_header, bytes(UUID_HEADER_6_SERIES), bytes(UUID_HEADER_7_SERIES), bytes(UUID_HEADER_X79));
+    data += QByteArray(values.uuid, UUID_LENGTH - MAC_LENGTH);
+    data += QByteArray(values.mac, MAC_LENGTH);
+
+    data += header(layout.mbsn_header, bytes(MBSN_HEADER_6_SERIES), bytes(MBSN_HEADER_7_SERIES), bytes(MBSN_HEADER_X79));
+    data += QByteArray(values.mbsn, MBSN_BODY_LENGTH - 1);
+    data += '\0';
+    return data;
+}
+
+generator_options_t ImageGenerator::defaultOptions()
+{
+    generator_options_t options;
+    options.size = 8 * 1024 * 1024;
+    options.descriptor = false;
+    options.layout = Layout6Series;
+    options.me = Me5M;
+    options.gbe_count = 0;
+    options.mac_type = ASCII;
+    options.dts_type = Long;
+    options.dts_magic = 1;
+    options.module_count = 1;
+    options.volume = false;
+    options.module_size = 0x1000;
+    options.module_padding = 0;
+    options.empty_module = false;
+    options.decoys_per_mb = 0;
+    options.seed = 0xFD44;
+    return options;
+}
+
+QString ImageGenerator::validate(const generator_options_t & options)
+{
+    if (options.layout < 0 || options.layout >= LayoutCount)
+        return "unknown module layout";
+    const layout_t & layout = LAYOUTS[options.layout];
+
+    if (options.gbe_count < 0 || options.gbe_count > 2)
+        return "GbE region count must be 0, 1 or 2";
+    if (options.module_count < 1)
+        return "at least one module is required";
+    if (options.module_padding < 0 || options.decoys_per_mb < 0)
+        return "module padding and decoy density can't be negative";
+
+    // Parser takes MAC from GbE if it is present, ASCII MAC is searched otherwise
+    if (options.mac_type == GbE && options.gbe_count == 0)
+        return "GbE MAC storage requires GbE region";
+    if (options.mac_type == ASCII && layout.mac_header == NoHeader)
+        return QString("ASCII MAC is not supported by %1 layout").arg(layout.name);
+    if (options.mac_type == ASCII && options.gbe_count != 0)
+        return "ASCII MAC can't be combined with GbE region";
+    if (options.mac_type != UUID && options.mac_type != ASCII && options.mac_type != GbE)
+        return "unknown MAC storage type";
+
+    if (options.dts_type == Short && layout.dts_short_header == NoHeader)
+        return QString("short DTS key is not supported by %1 layout").arg(layout.name);
+    if (options.dts_type == Long && layout.dts_long_header == NoHeader)
+        return QString("long DTS key is not supported by %1 layout").arg(layout.name);
+    if (options.dts_type != None && options.dts_type != Short && options.dts_type != Long)
+        return "unknown DTS key type";
+    if (options.dts_type == Long && (options.dts_magic < 1 || options.dts_magic > 3))
+        return "long DTS key magic must be 1, 2 or 3";
+
+    // Files in volume are 8-byte aligned
+    if (options.volume && options.module_size % FFS_ALIGNMENT != 0)
+        return QString("module size must be a multiple of %1 bytes in firmware volume").arg(FFS_ALIGNMENT);
+
+    values_t values = generateValues(options.seed);
+    int dataSize = options.empty_module ? 0 : options.module_padding + moduleData(options, values).size();
+    if (options.module_size < MODULE_HEADER_LENGTH + dataSize || options.module_size > 0xFFFFFF)
+        return QString("module size must be from %1 to %2 bytes").arg(MODULE_HEADER_LENGTH + dataSize).arg(0xFFFFFF);
+
+    // Modules are placed in the middle of image, structures at its start and end
+    if (options.size < 1024 * 1024 || options.size / 2 - STRUCTURES_END < options.module_count * options.module_size)
+        return "image is too small for requested modules";
+
+    return QString();
+}
+
+QByteArray ImageGenerator::generate(const generator_options_t & options)
+{
+    const layout_t & layout = LAYOUTS[options.layout];
+    values_t values = generateValues(options.seed);
+    quint32 state = initRandom(options.seed, 0x494D4147);
+    int size = options.size;
+
+    // Half of the image is filled with incompressible data split into volumes, the rest is 0xFF padding
+    QByteArray image(size, '\xFF');
+    for (int volume = 0; volume < 8; volume++)
+    {
+        char *start = image.data() + volume * (size / 8);
+        for (int i = 0; i < size / 16; i++)
+            start[i] = (char)nextRandom(state);
+    }
+
+    // Modules are placed in the middle, reserved range is kept free of decoys
+    int modulesStart = size / 2 + MODULES_FROM_MIDDLE;
+    int modulesEnd = modulesStart + options.module_count * options.module_size;
+    int volumeEnd = size / 2 + (modulesEnd - size / 2 + FV_BLOCK_SIZE - 1) / FV_BLOCK_SIZE * FV_BLOCK_SIZE;
+
+    // Near-miss signature copies differ from real ones in the middle byte,
+    // so they pass first and last byte filters of the scanner but never match
+    if (options.decoys_per_mb > 0)
+    {
+        QList<QByteArray> signatures;
+        signatures << bytes(BOOTEFI_HEADER) << bytes(ME_HEADER) << bytes(ME_3M_SIGN) << bytes(ME_5M_SIGN)
+                   << bytes(ME_VERSION_HEADER) << bytes(GBE_HEADER) << bytes(MODULE_HEADER);
+
+        qint64 decoys = (qint64)options.decoys_per_mb * size / (1024 * 1024);
+        for (qint64 i = 0; i < decoys; i++)
+        {
+            QByteArray decoy = signatures.at(i % signatures.size());
+            decoy[decoy.size() / 2] = (char)(decoy.at(decoy.size() / 2) ^ 0x5A);
+            int pos = STRUCTURES_END + (int)(nextRandom(state) % (quint32)(size - STRUCTURES_END - BOOTEFI_FROM_END - 0x100));
+            if (pos + decoy.size() > modulesStart - MODULES_FROM_MIDDLE && pos < volumeEnd + 0x100)
+                continue;
+            put(image, pos, decoy);
+        }
+    }
+
+    // Flash descriptor
+    if (options.descriptor)
+    {
+        memset(image.data(), 0xFF, FLASH_DESCRIPTOR_SIZE);
+        putUint32(image, FLASH_DESCRIPTOR_SIGNATURE_OFFSET, FLASH_DESCRIPTOR_SIGNATURE);
+        putUint32(image, FLASH_DESCRIPTOR_FLMAP0_OFFSET, (FRBA_OFFSET >> 4) << 16);
+        putUint32(image, FRBA_OFFSET + 4 * DescriptorRegion, flashRegion(0, ME_OFFSET));
+        putUint32(image, FRBA_OFFSET + 4 * BiosRegion, flashRegion(STRUCTURES_END, size));
+        putUint32(image, FRBA_OFFSET + 4 * MeRegion, flashRegion(ME_OFFSET, GBE_OFFSET));
+        putUint32(image, FRBA_OFFSET + 4 * GbeRegion, flashRegion(GBE_OFFSET, options.gbe_count > 0 ? STRUCTURES_END : GBE_OFFSET));
+        putUint32(image, FRBA_OFFSET + 4 * PdrRegion, flashRegion(0, 0));
+    }
+
+    // ME region with partition table, FTPR partition starts with manifest,
+    // larger firmware has additional OPR1 and BIEL partitions
+    if (options.me != NoMe)
+    {
+        QList<QByteArray> names;
+        names << bytes(ME_FTPR_NAME) + QByteArray(4, (char)0xFF) << QByteArray("NFTP\xFF\xFF\xFF\xFF", 8);
+        if (options.me == Me3M || options.me == Me5M)
+            names << bytes(ME_3M_SIGN);
+        if (options.me == Me5M)
+            names << bytes(ME_5M_SIGN);
+
+        int fpt = ME_OFFSET + ME_FPT_ROMB_LENGTH;
+        memset(image.data() + ME_OFFSET, 0, ME_PARTITION_SIZE);
+        put(image, fpt - ME_HEADER.size() + ME_FPT_SIGNATURE_LENGTH, bytes(ME_HEADER));
+        putUint32(image, fpt + ME_FPT_COUNT_OFFSET, names.size());
+        image[fpt + ME_FPT_HEADER_LENGTH_OFFSET] = ME_FPT_MIN_HEADER_LENGTH;
+        for (int i = 0; i < names.size(); i++)
+        {
+            int entry = fpt + ME_FPT_MIN_HEADER_LENGTH + i * ME_FPT_ENTRY_LENGTH;
+            put(image, entry, names.at(i));
+            putUint32(image, entry + ME_FPT_ENTRY_OFFSET_OFFSET, (i + 1) * ME_PARTITION_SIZE);
+            putUint32(image, entry + ME_FPT_ENTRY_LENGTH_OFFSET, ME_PARTITION_SIZE);
+        }
+
+        int manifest = ME_OFFSET + ME_PARTITION_SIZE + ME_MANIFEST_SIGNATURE_OFFSET;
+        put(image, manifest, bytes(ME_VERSION_HEADER));
+        put(image, manifest + ME_VERSION_HEADER.size() + ME_VERSION_OFFSET,
+            QByteArray("\x08\x00\x01\x00\x14\x00\x7D\x04", ME_VERSION_LENGTH));
+    }
+
+    // GbE regions, MAC and version are stored before the header
+    for (int i = 0; i < options.gbe_count; i++)
+    {
+        int pos = GBE_OFFSET + i * GBE_REGION_SIZE - GBE_MAC_OFFSET + MAC_LENGTH;
+        if (i == 0 && options.gbe_count == 2)
+            put(image, pos + GBE_MAC_OFFSET - MAC_LENGTH, bytes(GBE_MAC_STUB));
+        else
+            put(image, pos + GBE_MAC_OFFSET - MAC_LENGTH, QByteArray(values.mac, MAC_LENGTH));
+        put(image, pos + GBE_VERSION_OFFSET, QByteArray("\x10\x01", GBE_VERSION_LENGTH));
+        put(image, pos, bytes(GBE_HEADER));
+    }
+
+    // Firmware volume with pad file before modules and free space after them
+    if (options.volume)
+    {
+        int volume = size / 2;
+        putVolumeHeader(image, volume, volumeEnd - volume);
+        int pad = volume + FV_HEADER_SIZE;
+        memset(image.data() + pad, 0, FFS_HEADER_LENGTH);
+        memset(image.data() + pad + FFS_HEADER_LENGTH, 0xFF, modulesStart - pad - FFS_HEADER_LENGTH);
+        image[pad + FFS_TYPE_OFFSET] = (char)FFS_PAD_FILE_TYPE;
+        putUint32(image, pad + FFS_SIZE_OFFSET, modulesStart - pad);
+        memset(image.data() + modulesEnd, 0xFF, volumeEnd - modulesEnd);
+    }
+
+    // FD44 modules
+    QByteArray data = moduleData(options, values);
+    for (int i = 0; i < options.module_count; i++)
+    {
+        int pos = modulesStart + i * options.module_size;
+        char *module = image.data() + pos;
+        memset(module, 0, MODULE_HEADER_LENGTH);
+        memset(module + MODULE_HEADER_LENGTH, 0xFF, options.module_size - MODULE_HEADER_LENGTH);
+        put(image, pos, bytes(MODULE_HEADER));
+        module[MODULE_LENGTH_OFFSET]     = (char)(options.module_size & 0xFF);
+        module[MODULE_LENGTH_OFFSET + 1] = (char)(options.module_size >> 8 & 0xFF);
+        module[MODULE_LENGTH_OFFSET + 2] = (char)(options.module_size >> 16 & 0xFF);
+        module[MODULE_VERSION_OFFSET] = (char)MODULE_VERSIONS[layout.version_index];
+        put(image, pos + MODULE_HEADER_BSA_OFFSET, bytes(MODULE_HEADER_BSA));
+
+        if (options.empty_module)
+            continue;
+
+        // Padding bytes never form 0xFF, so module is not considered empty
+        pos += MODULE_HEADER_LENGTH;
+        for (int j = 0; j < options.module_padding; j++)
+            image[pos + j] = (char)(nextRandom(state) & 0x7F);
+        put(image, pos + options.module_padding, data);
+    }
+
+    // $BOOTEFI$ block near the end of image
+    int pos = size - BOOTEFI_FROM_END;
+    put(image, pos, bytes(BOOTEFI_HEADER));
+    pos += BOOTEFI_HEADER.size() + BOOTEFI_MAGIC_LENGTH;
+    put(image, pos, QByteArray("\x12\x34", BOOTEFI_BIOS_VERSION_LENGTH));
+    pos += BOOTEFI_BIOS_VERSION_LENGTH;
+    memset(image.data() + pos, 0, BOOTEFI_MOTHERBOARD_NAME_LENGTH);
+    put(image, pos, QByteArray(layout.board));
+    pos += BOOTEFI_MOTHERBOARD_NAME_LENGTH + BOOTEFI_BIOS_DATE_OFFSET;
+    put(image, pos, QByteArray("01/02/2013", BOOTEFI_BIOS_DATE_LENGTH));
+    pos += BOOTEFI_BIOS_DATE_LENGTH + BOOTEFI_RECOVERY_NAME_OFFSET;
+    memset(image.data() + pos, 0, BOOTEFI_RECOVERY_NAME_LENGTH);
+    put(image, pos, QByteArray(layout.board).left(8).append(".ROM"));
+
+    return image;
+}
+
+QStringList ImageGenerator::expectedKeys()
+{
+    return QStringList() << "motherboard" << "module_version" << "me_type" << "mac_type" << "mac"
+                         << "mac_magic" << "dts_type" << "dts_key" << "uuid" << "mbsn";
+}
+
+QStringList ImageGenerator::expectedValues(const generator_options_t & options)
+{
+    static const char* meTypes[] = {"", "1.5M", "3M", "5M"};
+    const layout_t & layout = LAYOUTS[options.layout];
+    values_t values = generateValues(options.seed);
+
+    QStringList result;
+    result << layout.board
+           << QByteArray(1, (char)MODULE_VERSIONS[layout.version_index]).toHex().toUpper()
+           << meTypes[options.me];
+
+    // Values of empty module, UUID MAC storage and missing DTS key
+    // are taken from board database, they are left empty
+    if (options.empty_module)
+    {
+        while (result.size() < expectedKeys().size())
+            result << QString();
+        return result;
+    }
+
+    result << (options.mac_type == ASCII ? "ascii" : options.mac_type == GbE ? "gbe" : "")
+           << QByteArray(values.mac, MAC_LENGTH).toHex().toUpper()
+           << (options.mac_type == ASCII && layout.mac_header == Header7Series ? QByteArray(1, values.mac_magic).toHex().toUpper() : QByteArray())
+           << (options.dts_type == Short ? "short" : options.dts_type == Long ? "long" : "")
+           << (options.dts_type == None ? QByteArray() : QByteArray(values.dts_key, DTS_KEY_LENGTH).toHex().toUpper())
+           << QByteArray(values.uuid, UUID_LENGTH - MAC_LENGTH).toHex().toUpper()
+           << QString::fromLatin1(values.mbsn, MBSN_BODY_LENGTH - 1);
+    return result;
+}
+
+const char* ImageGenerator::layoutName(layout_e layout)
+{
+    return LAYOUTS[layout].name;
+}
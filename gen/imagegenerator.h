@@ -0,0 +1,67 @@
+/* imagegenerator.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef IMAGEGENERATOR_H
+#define IMAGEGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "fd44parser.h"
+
+// FD44 module layouts, each one has its own module version and header set
+enum layout_e {Layout6Series, LayoutX79, LayoutC20x, LayoutC602, Layout7Series, Layout9Series, LayoutCount};
+
+enum generator_me_e {NoMe, Me15M, Me3M, Me5M};
+
+typedef struct {
+    int size;               // image size in bytes
+    bool descriptor;        // full flash dump with Intel flash descriptor
+    layout_e layout;
+    generator_me_e me;
+    int gbe_count;          // 0, 1 or 2 GbE regions, first of two holds MAC stub
+    mac_e mac_type;         // UUID, ASCII or GbE
+    dts_e dts_type;         // None, Short or Long
+    int dts_magic;          // 1 to 3, long DTS key magic variant
+    int module_count;       // identical FD44 modules placed one after another
+    bool volume;            // modules are files of UEFI firmware volume
+    int module_size;        // module length including header
+    int module_padding;     // pseudo-random bytes in module body before data
+    bool empty_module;      // module body is 0xFF only
+    int decoys_per_mb;      // near-miss copies of every image signature per megabyte
+    quint32 seed;           // random data and field values
+} generator_options_t;
+
+// Builds synthetic ASUS BIOS images that parser reads as real ones.
+// Same options and seed always produce the same image.
+class ImageGenerator
+{
+public:
+    static generator_options_t defaultOptions();
+
+    // Returns empty string if options describe valid image
+    static QString validate(const generator_options_t & options);
+
+    // Options must be valid
+    static QByteArray generate(const generator_options_t & options);
+
+    // Values written to image, same keys and format as in fd44 info output.
+    // Values parser takes from board database are empty and should not be compared.
+    static QStringList expectedKeys();
+    static QStringList expectedValues(const generator_options_t & options);
+
+    static const char* layoutName(layout_e layout);
+};
+
+#endif // IMAGEGENERATOR_H
@@ -0,0 +1,8 @@
+# Synthetic image generator shared by fd44gen and benchmark
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += $$PWD/imagegenerator.cpp
+
+HEADERS += $$PWD/imagegenerator.h
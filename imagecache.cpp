@@ -0,0 +1,131 @@
+/* imagecache.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "imagecache.h"
+#include "imagefile.h"
+#include "imagewriter.h"
+
+ImageCache::ImageCache()
+    : changed(false)
+{
+}
+
+void ImageCache::load(const QString & path)
+{
+    QMutexLocker locker(&mutex);
+    cachePath = path;
+    changed = false;
+
+    QFile file(path);
+    QByteArray data;
+    if (file.open(QFile::ReadOnly))
+        data = file.readAll();
+    cache.read(ByteView(data.constData(), data.size()));
+}
+
+bool ImageCache::save()
+{
+    QMutexLocker locker(&mutex);
+    if (!changed || cachePath.isEmpty())
+        return true;
+
+    std::vector<uint8_t> data;
+    cache.write(data);
+    changed = !ImageWriter::write(cachePath, QByteArray((const char*)data.data(), (int)data.size()));
+    return !changed;
+}
+
+static std::string fileKey(const QFileInfo & info)
+{
+    return info.absoluteFilePath().toUtf8().constData();
+}
+
+bool ImageCache::find(const QFileInfo & info, bios_t & bios, image_status_t & status)
+{
+    file_state_t state;
+    parse_result_t result;
+    {
+        QMutexLocker locker(&mutex);
+        if (!cache.findFile(fileKey(info), info.size(), info.lastModified().toMSecsSinceEpoch(), state.hash)
+            || !cache.findResult(state.hash, result))
+            return false;
+    }
+
+    bios = result.bios;
+    status = result.status;
+    return true;
+}
+
+void ImageCache::parse(const QFileInfo & info, const QByteArray & data, bios_t & bios, image_status_t & status)
+{
+    // File is stated before it is read, so file changed in between
+    // is stored with old modification time and parsed again next time
+    file_state_t state;
+    state.size = info.size();
+    state.mtime = info.lastModified().toMSecsSinceEpoch();
+
+    ByteView view(data.constData(), data.size());
+    state.hash = ParseCache::hash(view);
+    parse_result_t result;
+    image_offsets_t offsets;
+    bool found, known;
+    {
+        QMutexLocker locker(&mutex);
+        found = cache.findResult(state.hash, result);
+        known = !found && cache.findBuild(view, offsets);
+    }
+
+    // New image of known build is parsed without scanning,
+    // it is scanned if parsing with build offsets fails
+    if (!found && known)
+    {
+        result.status = FD44Image::read(view, offsets, result.bios);
+        known = (result.status.error == NoError);
+    }
+    if (!found && !known)
+    {
+        FD44Image::scan(view, offsets);
+        result.status = FD44Image::read(view, offsets, result.bios);
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        if (!found)
+            cache.addResult(state.hash, result);
+        if (!found && !known && result.status.error == NoError)
+            cache.addBuild(view, offsets);
+        cache.addFile(fileKey(info), state);
+        changed = true;
+    }
+
+    bios = result.bios;
+    status = result.status;
+}
+
+bool ImageCache::read(const QString & path, bios_t & bios, image_status_t & status)
+{
+    QFileInfo info(path);
+    if (find(info, bios, status))
+        return true;
+
+    ImageFile image;
+    if (!image.open(path))
+        return false;
+    parse(info, image.data(), bios, status);
+    return true;
+}
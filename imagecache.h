@@ -0,0 +1,58 @@
+/* imagecache.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QFileInfo>
+#include <QMutex>
+#include <QString>
+
+#include "fd44parser.h"
+#include "parsecache.h"
+
+// Parse results of image files kept on disk between runs.
+// Unchanged file is not read at all, only its size and modification time
+// are checked, changed file is hashed and parsed only if its content is new.
+// New image of already parsed BIOS build is not scanned, its signatures
+// are checked at offsets found in earlier image of that build.
+// Can be used from any number of threads at once.
+class ImageCache
+{
+public:
+    ImageCache();
+
+    // Missing, corrupted or outdated cache file gives empty cache
+    void load(const QString & path);
+    // Writes cache back to file it was loaded from if anything was added
+    bool save();
+
+    // Parses image file or takes its result from cache,
+    // returns false if file can't be opened
+    bool read(const QString & path, bios_t & bios, image_status_t & status);
+
+    // Result of file unchanged since it was cached, file is not read
+    bool find(const QFileInfo & info, bios_t & bios, image_status_t & status);
+    // Parses image data without capsule header read from file after it was stated
+    void parse(const QFileInfo & info, const QByteArray & data, bios_t & bios, image_status_t & status);
+
+private:
+    QMutex mutex;
+    ParseCache cache;
+    QString cachePath;
+    bool changed;
+
+    Q_DISABLE_COPY(ImageCache)
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,85 @@
+/* imagefile.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "imagefile.h"
+#include "fd44parser.h"
+
+ImageFile::ImageFile()
+    : mapped(0), start(0), length(0), imageOffset(0)
+{
+}
+
+ImageFile::~ImageFile()
+{
+    close();
+}
+
+bool ImageFile::open(const QString & path)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    // QByteArray can't address more than 2 GB
+    qint64 size = file.size();
+    if (size > 0x7FFFFFFF)
+    {
+        file.close();
+        return false;
+    }
+
+    if (size > 0)
+        mapped = file.map(0, size);
+
+    if (mapped)
+    {
+        start = (const char*)mapped;
+        length = (int)size;
+    }
+    else
+    {
+        // Empty or special file
+        buffer = file.readAll();
+        file.close();
+        start = buffer.constData();
+        length = buffer.size();
+    }
+
+    imageOffset = FD44Parser::capsuleOffset(QByteArray::fromRawData(start, length));
+    return true;
+}
+
+void ImageFile::close()
+{
+    if (mapped)
+        file.unmap(mapped);
+    mapped = 0;
+    file.close();
+
+    buffer.clear();
+    start = 0;
+    length = 0;
+    imageOffset = 0;
+}
+
+QByteArray ImageFile::data() const
+{
+    return QByteArray::fromRawData(start + imageOffset, length - imageOffset);
+}
+
+int ImageFile::offset() const
+{
+    return imageOffset;
+}
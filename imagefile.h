@@ -0,0 +1,52 @@
+/* imagefile.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef IMAGEFILE_H
+#define IMAGEFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// Read-only BIOS image file.
+// File is memory-mapped, so only pages touched by parser are loaded,
+// and capsule header is skipped by offset without copying image data.
+class ImageFile
+{
+public:
+    ImageFile();
+    ~ImageFile();
+
+    // Maps file, falls back to reading it if mapping is not possible
+    bool open(const QString & path);
+    void close();
+
+    // Image data without capsule header, shares memory with the file
+    // and must not be used after it is closed
+    QByteArray data() const;
+
+    // Offset of image data in file, non-zero for capsule files
+    int offset() const;
+
+private:
+    QFile file;
+    uchar *mapped;
+    QByteArray buffer;
+    const char *start;
+    int length;
+    int imageOffset;
+
+    Q_DISABLE_COPY(ImageFile)
+};
+
+#endif // IMAGEFILE_H
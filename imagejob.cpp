@@ -0,0 +1,133 @@
+/* imagejob.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#include <string.h>
+
+#include <QFile>
+
+#include "imagefile.h"
+#include "imagejob.h"
+#include "imagewriter.h"
+
+// Cancel flag and progress are checked after every chunk,
+// every page of chunk is touched to load it from disk
+static const int READ_CHUNK_SIZE = 0x100000;
+static const int PAGE_LENGTH = 0x1000;
+
+ImageJob::ImageJob(job_e type, const QString & path, ImageCache *cache, const bios_t & bios)
+    : jobType(type), info(path), cache(cache), jobBios(bios), jobResult(Canceled), canceled(0)
+{
+    memset(&jobStatus, 0, sizeof(jobStatus));
+    setAutoDelete(false);
+}
+
+void ImageJob::run()
+{
+    jobResult = (jobType == LoadJob) ? load() : save();
+    emit finished();
+}
+
+void ImageJob::cancel()
+{
+    canceled.fetchAndStoreOrdered(1);
+}
+
+bool ImageJob::isCanceled()
+{
+    // Compares with 1 and keeps it, reads flag on both Qt 4 and Qt 5
+    return canceled.testAndSetOrdered(1, 1);
+}
+
+ImageJob::result_e ImageJob::readFile(ImageFile & image)
+{
+    if (!image.open(info.filePath()))
+        return ReadFailed;
+
+    // Mapped image is not copied, its pages are read in by touching them,
+    // so parser finds them in page cache
+    QByteArray data = image.data();
+    int size = data.size();
+    int percent = -1;
+    volatile char touched = 0;
+    for (int done = 0; done < size; )
+    {
+        if (isCanceled())
+            return Canceled;
+
+        int end = qMin(done + READ_CHUNK_SIZE, size);
+        for (; done < end; done += PAGE_LENGTH)
+            touched ^= data.at(done);
+        done = end;
+
+        if ((qint64)done * 100 / size != percent)
+        {
+            percent = (int)((qint64)done * 100 / size);
+            emit progress(percent);
+        }
+    }
+    return Done;
+}
+
+ImageJob::result_e ImageJob::load()
+{
+    // Unchanged file is not read
+    if (cache->find(info, jobBios, jobStatus))
+        emit progress(100);
+    else
+    {
+        ImageFile image;
+        result_e result = readFile(image);
+        if (result != Done)
+            return result;
+        cache->parse(info, image.data(), jobBios, jobStatus);
+    }
+
+    // Parsing errors don't refer to image data
+    if (jobStatus.error != NoError)
+    {
+        message = FD44Parser::errorString(jobStatus, QByteArray(), jobBios);
+        return ParseFailed;
+    }
+    return Done;
+}
+
+ImageJob::result_e ImageJob::save()
+{
+    ImageFile image;
+    result_e result = readFile(image);
+    if (result != Done)
+        return result;
+
+    QList<patch_t> patches;
+    jobStatus = FD44Parser::buildPatches(image.data(), jobBios, patches);
+    if (jobStatus.error != NoError)
+    {
+        message = FD44Parser::errorString(jobStatus, image.data(), jobBios);
+        return ParseFailed;
+    }
+
+    // Mapping is closed before writing to the same file. Only changed ranges
+    // are written in place, capsule header can't be removed in place, so image
+    // is copied without it over the file, sharing unchanged data where filesystem allows
+    QString path = info.filePath();
+    int offset = image.offset(), size = image.data().size();
+    image.close();
+    bool written = (offset == 0) ? ImageWriter::patch(path, patches)
+                                 : ImageWriter::copy(path, path, patches, offset, size);
+    if (!written)
+        return WriteFailed;
+
+    QFile::rename(path, QString("%1/%2.bin").arg(info.path()).arg(info.completeBaseName()));
+    return Done;
+}
@@ -0,0 +1,82 @@
+/* imagejob.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#ifndef IMAGEJOB_H
+#define IMAGEJOB_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFileInfo>
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+#include "fd44parser.h"
+#include "imagecache.h"
+#include "imagefile.h"
+
+// Loading or saving of image file run in thread pool, so GUI stays responsive
+// with slow network shares. File is memory-mapped and its pages are read in
+// chunks, progress is reported by bytes read and job can be canceled until
+// whole file is read; parsing of image in memory is fast and is never
+// interrupted, neither is writing, so canceled save leaves file unchanged.
+class ImageJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    enum job_e {LoadJob, SaveJob};
+    enum result_e {Done, Canceled, ReadFailed, ParseFailed, WriteFailed};
+
+    // Load parses file through cache, save writes bios values into file
+    ImageJob(job_e type, const QString & path, ImageCache *cache, const bios_t & bios = bios_t());
+
+    void run();
+
+    job_e type() const { return jobType; }
+    QFileInfo fileInfo() const { return info; }
+    result_e result() const { return jobResult; }
+    // Loaded or saved values and parse status
+    const bios_t & bios() const { return jobBios; }
+    image_status_t status() const { return jobStatus; }
+    // Parse error message, made while image data is still available
+    QString errorString() const { return message; }
+
+public slots:
+    // Can be called from any thread
+    void cancel();
+
+signals:
+    void progress(int percent);
+    void finished();
+
+private:
+    const job_e jobType;
+    const QFileInfo info;
+    ImageCache *cache;
+    bios_t jobBios;
+    image_status_t jobStatus;
+    result_e jobResult;
+    QString message;
+    QAtomicInt canceled;
+
+    result_e load();
+    result_e save();
+    result_e readFile(ImageFile & image);
+    bool isCanceled();
+
+    Q_DISABLE_COPY(ImageJob)
+};
+
+#endif // IMAGEJOB_H
@@ -0,0 +1,232 @@
+/* imagelistmodel.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#include <string.h>
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include "imagelistmodel.h"
+
+// Parses dropped file or searches dropped folder
+class ImageListTask : public QRunnable
+{
+public:
+    ImageListTask(ImageListModel *model, const QString & path) : model(model), path(path) {}
+
+    void run()
+    {
+        if (model->isStopped())
+        {
+            model->taskDone(0);
+            return;
+        }
+
+        if (QFileInfo(path).isDir())
+        {
+            QStringList files;
+            QDirIterator it(path, QStringList() << "*.rom" << "*.bin" << "*.cap", QDir::Files,
+                            QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+            while (it.hasNext())
+                files.append(it.next());
+            model->addFiles(files);
+            model->taskDone(0);
+            return;
+        }
+
+        image_entry_t entry;
+        entry.path = path;
+        memset(&entry.bios, 0, sizeof(entry.bios));
+        image_status_t status;
+        if (!model->imageCache()->read(path, entry.bios, status))
+        {
+            entry.bios.state = ParseError;
+            entry.error = ImageListModel::tr("Can't open file for reading.");
+        }
+        else if (status.error != NoError)
+            entry.error = FD44Parser::errorString(status, QByteArray(), entry.bios);
+        model->taskDone(&entry);
+    }
+
+private:
+    ImageListModel *model;
+    QString path;
+};
+
+ImageListModel::ImageListModel(ImageCache *cache, QObject *parent)
+    : QAbstractTableModel(parent), cache(cache), stopped(0), running(0), posted(false), finishing(false)
+{
+}
+
+ImageListModel::~ImageListModel()
+{
+    stopped.fetchAndStoreOrdered(1);
+    pool.waitForDone();
+}
+
+bool ImageListModel::isStopped()
+{
+    // Compares with 1 and keeps it, reads flag on both Qt 4 and Qt 5
+    return stopped.testAndSetOrdered(1, 1);
+}
+
+void ImageListModel::addFiles(const QStringList & paths)
+{
+    {
+        QMutexLocker locker(&mutex);
+        running += paths.size();
+    }
+    for (int i = 0; i < paths.size(); i++)
+        pool.start(new ImageListTask(this, paths.at(i)));
+}
+
+void ImageListModel::taskDone(const image_entry_t *entry)
+{
+    QMutexLocker locker(&mutex);
+    if (entry)
+        pending.append(*entry);
+    if (--running == 0)
+        finishing = true;
+
+    // Results arriving before view took previous ones are added with them
+    if (!posted && (entry || finishing))
+    {
+        posted = true;
+        QMetaObject::invokeMethod(this, "insertPending", Qt::QueuedConnection);
+    }
+}
+
+void ImageListModel::insertPending()
+{
+    QList<image_entry_t> batch;
+    bool done;
+    {
+        QMutexLocker locker(&mutex);
+        batch.swap(pending);
+        done = finishing;
+        finishing = false;
+        posted = false;
+    }
+
+    // Same file dropped twice before its row was added gets one row
+    QList<image_entry_t> added;
+    QHash<QString, int> addedRows;
+    for (int i = 0; i < batch.size(); i++)
+    {
+        const QString & path = batch.at(i).path;
+        if (rows.contains(path))
+        {
+            int row = rows.value(path);
+            entries[row] = batch.at(i);
+            emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        }
+        else if (addedRows.contains(path))
+            added[addedRows.value(path)] = batch.at(i);
+        else
+        {
+            addedRows.insert(path, added.size());
+            added.append(batch.at(i));
+        }
+    }
+
+    if (!added.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), entries.size(), entries.size() + added.size() - 1);
+        for (int i = 0; i < added.size(); i++)
+        {
+            rows.insert(added.at(i).path, entries.size());
+            entries.append(added.at(i));
+        }
+        endInsertRows();
+    }
+
+    if (done)
+        emit finished();
+}
+
+QString ImageListModel::path(int row) const
+{
+    return entries.at(row).path;
+}
+
+int ImageListModel::rowCount(const QModelIndex & parent) const
+{
+    return parent.isValid() ? 0 : entries.size();
+}
+
+int ImageListModel::columnCount(const QModelIndex & parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ImageListModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid() || index.row() >= entries.size())
+        return QVariant();
+
+    const image_entry_t & entry = entries.at(index.row());
+    if (role == Qt::ToolTipRole)
+        return (index.column() == StateColumn && !entry.error.isEmpty()) ? entry.error : entry.path;
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    const bios_t & bios = entry.bios;
+    if (bios.state == ParseError && index.column() != FileColumn && index.column() != StateColumn)
+        return QString();
+
+    switch (index.column())
+    {
+    case FileColumn:
+        return QFileInfo(entry.path).fileName();
+    case BoardColumn:
+        return FD44Parser::fieldText(FD44Parser::field(bios, MotherboardNameField));
+    case BiosVersionColumn:
+        return FD44Parser::biosVersionString(bios);
+    case MacColumn:
+        return FD44Parser::fieldHex(FD44Parser::field(bios, MacField));
+    case UuidColumn:
+        return FD44Parser::fieldHex(FD44Parser::field(bios, UuidField));
+    case MbsnColumn:
+        return FD44Parser::fieldText(FD44Parser::field(bios, MbsnField));
+    case DtsColumn:
+        return (bios.dts_type == Short || bios.dts_type == Long) ? FD44Parser::fieldHex(FD44Parser::field(bios, DtsKeyField)) : QString();
+    case StateColumn:
+        switch (bios.state)
+        {
+        case Empty:
+            return tr("Empty");
+        case Valid:
+            return tr("Valid");
+        case HasNotDetectedValues:
+            return tr("Not detected");
+        default:
+            return tr("Error: %1").arg(QString(entry.error).replace('\n', ' '));
+        }
+    }
+    return QVariant();
+}
+
+QVariant ImageListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    static const char* headers[] = {QT_TR_NOOP("File"), QT_TR_NOOP("Board"), QT_TR_NOOP("BIOS version"), QT_TR_NOOP("MAC"),
+                                    QT_TR_NOOP("UUID"), QT_TR_NOOP("MBSN"), QT_TR_NOOP("DTS key"), QT_TR_NOOP("State")};
+
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= ColumnCount)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    return tr(headers[section]);
+}
@@ -0,0 +1,89 @@
+/* imagelistmodel.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#ifndef IMAGELISTMODEL_H
+#define IMAGELISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "fd44parser.h"
+#include "imagecache.h"
+
+typedef struct {
+    QString path;
+    bios_t bios;
+    QString error;
+} image_entry_t;
+
+// Table of images dropped onto editor window.
+// Files and folders are parsed through cache by thread pool tasks, rows are
+// added in batches as tasks finish, and cell text is made only when view
+// asks for it. File dropped again replaces its row.
+class ImageListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum column_e {FileColumn, BoardColumn, BiosVersionColumn, MacColumn, UuidColumn,
+                   MbsnColumn, DtsColumn, StateColumn, ColumnCount};
+
+    ImageListModel(ImageCache *cache, QObject *parent = 0);
+    // Queued files are skipped, running tasks are waited for
+    ~ImageListModel();
+
+    // Folders are searched for image files in their subfolders too
+    void addFiles(const QStringList & paths);
+    QString path(int row) const;
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    int columnCount(const QModelIndex & parent = QModelIndex()) const;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // Called by pool tasks, folder tasks have no entry
+    ImageCache *imageCache() const { return cache; }
+    bool isStopped();
+    void taskDone(const image_entry_t *entry);
+
+signals:
+    // All added files are parsed
+    void finished();
+
+private slots:
+    void insertPending();
+
+private:
+    ImageCache *cache;
+    QThreadPool pool;
+    QAtomicInt stopped;
+    QList<image_entry_t> entries;
+    QHash<QString, int> rows;
+
+    // Shared with pool tasks
+    QMutex mutex;
+    QList<image_entry_t> pending;
+    int running;
+    bool posted;
+    bool finishing;
+
+    Q_DISABLE_COPY(ImageListModel)
+};
+
+#endif // IMAGELISTMODEL_H
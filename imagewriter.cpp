@@ -0,0 +1,222 @@
+/* imagewriter.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <QtGlobal>
+
+#include <stdio.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#include <QDir>
+#include <QTemporaryFile>
+
+#include "imagewriter.h"
+
+#define COPY_CHUNK_SIZE 0x100000
+
+bool ImageWriter::patch(const QString & path, const QList<patch_t> & patches, qint64 offset)
+{
+    // Unbuffered, so every range is written by single positioned write
+    QFile file(path);
+    if (!file.open(QFile::ReadWrite | QFile::Unbuffered))
+        return false;
+
+    if (!writePatches(file, patches, offset))
+        return false;
+
+    return sync(file);
+}
+
+bool ImageWriter::write(const QString & path, const QByteArray & data)
+{
+    QString tempPath = createTemp(path);
+    if (tempPath.isEmpty())
+        return false;
+
+    QFile file(tempPath);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(data) != data.size() || !sync(file))
+    {
+        file.close();
+        QFile::remove(tempPath);
+        return false;
+    }
+    file.close();
+
+    return replace(tempPath, path, path);
+}
+
+bool ImageWriter::copy(const QString & source, const QString & path, const QList<patch_t> & patches,
+                       qint64 offset, qint64 length, copy_method_e *method)
+{
+    QFile input(source);
+    if (!input.open(QFile::ReadOnly))
+        return false;
+
+    if (length < 0)
+        length = input.size() - offset;
+    if (offset < 0 || length < 0 || offset + length > input.size())
+        return false;
+
+    // Output is written next to path and replaces it only when complete,
+    // so source is never truncated even if it is the same file
+    QString tempPath = createTemp(path);
+    if (tempPath.isEmpty())
+        return false;
+    QFile output(tempPath);
+    if (!output.open(QFile::ReadWrite | QFile::Truncate | QFile::Unbuffered))
+    {
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    copy_method_e used;
+    if (!copyData(input, output, offset, length, used) || !writePatches(output, patches, 0) || !sync(output))
+    {
+        output.close();
+        QFile::remove(tempPath);
+        return false;
+    }
+    output.close();
+    input.close();
+
+    // New file gets permissions of source
+    if (!replace(tempPath, path, QFile::exists(path) ? path : source))
+        return false;
+
+    if (method)
+        *method = used;
+    return true;
+}
+
+QString ImageWriter::createTemp(const QString & path)
+{
+    QTemporaryFile file(path + ".XXXXXX");
+    file.setAutoRemove(false);
+    if (!file.open())
+        return QString();
+    return file.fileName();
+}
+
+bool ImageWriter::replace(const QString & tempPath, const QString & path, const QString & permissionsPath)
+{
+    // Temporary file is created readable by owner only
+    QFile::Permissions permissions = QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser
+                                     | QFile::ReadGroup | QFile::ReadOther;
+    if (QFile::exists(permissionsPath))
+        permissions = QFile::permissions(permissionsPath);
+
+    // Path is replaced by single rename, so it is never missing
+    bool replaced = QFile::setPermissions(tempPath, permissions);
+#ifdef Q_OS_WIN
+    replaced = replaced && MoveFileExW((LPCWSTR)QDir::toNativeSeparators(tempPath).utf16(), (LPCWSTR)QDir::toNativeSeparators(path).utf16(),
+                                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    replaced = replaced && ::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(path).constData()) == 0;
+#endif
+    if (!replaced)
+        QFile::remove(tempPath);
+    return replaced;
+}
+
+bool ImageWriter::writePatches(QFile & file, const QList<patch_t> & patches, qint64 offset)
+{
+    for (int i = 0; i < patches.size(); i++)
+    {
+        const patch_t & patch = patches.at(i);
+        if (!file.seek(offset + patch.offset) || file.write(patch.data) != patch.data.size())
+            return false;
+    }
+    return true;
+}
+
+bool ImageWriter::copyData(QFile & input, QFile & output, qint64 offset, qint64 length, copy_method_e & method)
+{
+#ifdef Q_OS_LINUX
+    // Shared extents, only whole file or block-aligned ranges can be cloned
+    int in = input.handle(), out = output.handle();
+    int cloned;
+    if (offset == 0 && length == input.size())
+        cloned = ioctl(out, FICLONE, in);
+    else
+    {
+        struct file_clone_range range;
+        range.src_fd = in;
+        range.src_offset = offset;
+        range.src_length = length;
+        range.dest_offset = 0;
+        cloned = ioctl(out, FICLONERANGE, &range);
+    }
+    if (cloned == 0)
+    {
+        method = CloneCopy;
+        return true;
+    }
+
+#ifdef SYS_copy_file_range
+    // Kernel copy, also falls back to shared extents on some filesystems
+    qint64 inOffset = offset, outOffset = 0;
+    qint64 left = length;
+    while (left > 0)
+    {
+        ssize_t copied = syscall(SYS_copy_file_range, in, &inOffset, out, &outOffset, (size_t)left, 0);
+        if (copied <= 0)
+            break;
+        left -= copied;
+    }
+    if (left == 0)
+    {
+        method = KernelCopy;
+        return true;
+    }
+
+    // Unsupported, e.g. across filesystems on older kernels, copied part is discarded
+    if (!output.resize(0))
+        return false;
+#endif
+#endif
+
+    method = ReadWriteCopy;
+    if (!input.seek(offset) || !output.seek(0))
+        return false;
+    while (length > 0)
+    {
+        QByteArray chunk = input.read(qMin(length, (qint64)COPY_CHUNK_SIZE));
+        if (chunk.isEmpty() || output.write(chunk) != chunk.size())
+            return false;
+        length -= chunk.size();
+    }
+    return true;
+}
+
+bool ImageWriter::sync(QFile & file)
+{
+    if (!file.flush())
+        return false;
+
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
@@ -0,0 +1,59 @@
+/* imagewriter.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include "fd44parser.h"
+
+// How copy() created output file
+enum copy_method_e {CloneCopy, KernelCopy, ReadWriteCopy};
+
+class ImageWriter
+{
+public:
+    // Writes only patched ranges to existing file, offset is added to every
+    // patch offset, then file is synced to disk once
+    static bool patch(const QString & path, const QList<patch_t> & patches, qint64 offset = 0);
+
+    // Replaces whole file content, data is written to temporary file next to path
+    // and renamed over it, so path is either old or new file if writing fails
+    static bool write(const QString & path, const QByteArray & data);
+
+    // Creates path from length bytes of source starting at offset, whole rest of file by default,
+    // then writes patches relative to that range and syncs file once.
+    // Output is written to temporary file and renamed over path the same way as by write(),
+    // so path can be source itself.
+    // Copy-on-write clone is made on filesystems supporting it, otherwise data is copied
+    // inside the kernel, and read and written as the last resort.
+    static bool copy(const QString & source, const QString & path, const QList<patch_t> & patches,
+                     qint64 offset = 0, qint64 length = -1, copy_method_e *method = 0);
+
+private:
+    static bool writePatches(QFile & file, const QList<patch_t> & patches, qint64 offset);
+    static bool copyData(QFile & input, QFile & output, qint64 offset, qint64 length, copy_method_e & method);
+    static bool sync(QFile & file);
+
+    // Creates empty uniquely named file in directory of path, returns its name or empty string
+    static QString createTemp(const QString & path);
+    // Renames temporary file over path in one step and gives it permissions of permissionsPath,
+    // temporary file is removed if it fails
+    static bool replace(const QString & tempPath, const QString & path, const QString & permissionsPath);
+};
+
+#endif // IMAGEWRITER_H
@@ -0,0 +1,183 @@
+/* bios.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef BIOS_H
+#define BIOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <utility>
+
+// Signatures are constant byte arrays with compile-time length,
+// so no code runs at startup and compares against them have fixed size
+template <size_t N> using signature_t = std::array<uint8_t, N>;
+
+template <size_t N, size_t... I> constexpr signature_t<N - 1> makeSignature(const char (&bytes)[N], std::index_sequence<I...>)
+{
+    return {{(uint8_t)bytes[I]...}};
+}
+
+// Converts string literal to signature, terminating zero is not included
+template <size_t N> constexpr signature_t<N - 1> signature(const char (&bytes)[N])
+{
+    return makeSignature(bytes, std::make_index_sequence<N - 1>());
+}
+
+// Capsule header
+typedef struct _EFI_CAPSULE_HEADER {
+    uint8_t   CapsuleGuid[16];
+    uint32_t  HeaderSize;
+    uint32_t  Flags;
+    uint32_t  CapsuleImageSize;
+} EFI_CAPSULE_HEADER;
+
+// AMI Aptio extended capsule header
+typedef struct _APTIO_CAPSULE_HEADER {
+    EFI_CAPSULE_HEADER    CapsuleHeader;
+    uint16_t              RomImageOffset;	// offset in bytes from the beginning of the capsule header to the start of
+                                            // the capsule volume
+
+} APTIO_CAPSULE_HEADER;
+
+// AMI Aptio extended capsule GUID
+constexpr auto APTIO_CAPSULE_GUID         = signature("\x8B\xA6\x3C\x4A\x23\x77\xFB\x48\x80\x3D\x57\x8C\xC1\xFE\xC4\x4D");
+
+// BOOTEFI marker
+constexpr auto BOOTEFI_HEADER             = signature("$BOOTEFI$");
+#define BOOTEFI_MAGIC_LENGTH                3
+#define BOOTEFI_BIOS_VERSION_LENGTH         2
+#define BOOTEFI_BIOS_DATE_OFFSET            21
+#define BOOTEFI_BIOS_DATE_LENGTH            10
+#define BOOTEFI_MOTHERBOARD_NAME_LENGTH     60
+#define BOOTEFI_RECOVERY_NAME_LENGTH        12
+#define BOOTEFI_RECOVERY_NAME_OFFSET        40
+
+// ME header
+constexpr auto ME_HEADER                  = signature("\x00\x00\x00\x00\x24\x46\x50\x54");
+constexpr auto ME_3M_SIGN                 = signature("\x4F\x50\x52\x31\xFF\xFF\xFF\xFF");
+constexpr auto ME_5M_SIGN                 = signature("\x42\x49\x45\x4C\xFF\xFF\xFF\xFF");
+constexpr auto ME_VERSION_HEADER          = signature("\x24\x4D\x4E\x32");
+#define ME_VERSION_OFFSET                   4
+#define ME_VERSION_LENGTH                   8
+
+// GbE header
+constexpr auto GBE_HEADER                 = signature("\xFF\xFF\xFF\xFF\xC3\x10");
+#define GBE_MAC_OFFSET                      (-10)
+constexpr auto GBE_MAC_STUB               = signature("\x88\x88\x88\x88\x87\x88");
+#define GBE_VERSION_OFFSET                  (-6)
+#define GBE_VERSION_LENGTH                  2
+
+// FD44 module
+constexpr auto MODULE_HEADER              = signature("\x0B\x82\x44\xFD\xAB\xF1\xC0\x41\xAE\x4E\x0C\x55\x55\x6E\xB9\xBD");
+#define MODULE_VERSION_OFFSET               25
+constexpr auto MODULE_VERSIONS            = signature("\x02\x04\x08\x10");
+#define MODULE_VERSION_LENGTH               1
+#define MODULE_HEADER_BSA_OFFSET            28
+constexpr auto MODULE_HEADER_BSA          = signature("BSA_");
+#define MODULE_HEADER_LENGTH                36
+#define MODULE_LENGTH_OFFSET                20
+
+// ASCII MAC
+#define MAC_LENGTH                          6
+constexpr auto ASCII_MAC_HEADER_6_SERIES  = signature("\x0B\x01\x0D\x00");
+constexpr auto ASCII_MAC_HEADER_7_SERIES  = signature("\x0B\x01\x00\x80\x09\x0D\x00");
+#define ASCII_MAC_OFFSET                    2
+#define ASCII_MAC_LENGTH                    13
+#define ASCII_MAC_MAGIC_LENGTH              1
+
+// DTS key
+#define DTS_KEY_LENGTH 8
+constexpr auto DTS_SHORT_HEADER_6_SERIES  = signature("\x8B\x04\x26\x00");
+constexpr auto DTS_SHORT_PART2            = signature("\x04\x04\x32\x55\xF8\x00\xA2\x02\xA1\x00\x40\x63\x43\x10\xFE\x81\x03\xDF\x40\xB2\x00\x20\x00\x73\x3C\x10\x08\x00\x00\x00");
+
+constexpr auto DTS_LONG_HEADER_6_SERIES   = signature("\x8B\x04\x4E\x00");
+constexpr auto DTS_LONG_HEADER_7_SERIES   = signature("\x8B\x04\x00\x00\x00\x4E\x00\x00\x02");
+constexpr auto DTS_LONG_HEADER_X79        = signature("\x8B\x00\x00\x04\x4E\x00\x00");
+
+constexpr auto DTS_LONG_PART2             = signature("\x04\x04\x32\x55\xF8\x00\xA2\x02\xA1\x00\x40\x63\x43\x10\x84\x83\x03\xDF\x40\x80\x00\x20\x00\x73\x3C\x10\x08\x00\x60\x0F");
+
+#define DTS_LONG_MAGIC_LENGTH               13
+typedef signature_t<DTS_LONG_MAGIC_LENGTH> dts_magic_t;
+constexpr dts_magic_t DTS_LONG_MAGIC_V1   = signature("\x43\x10\x15\x04\x20\x00\x3C\x10\x00\x00\x00\x43\x10");
+constexpr dts_magic_t DTS_LONG_MAGIC_V2   = signature("\x06\x11\x15\x04\x20\x00\x3C\x10\x00\x00\x00\x00\x00"); //P67-M PRO
+constexpr dts_magic_t DTS_LONG_MAGIC_V3   = signature("\x43\x10\x84\x83\x20\x00\x3C\x10\x00\x00\x00\x43\x10"); //P67 WS
+
+constexpr auto DTS_LONG_PART3             = signature("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00");
+constexpr auto DTS_LONG_MASK              = signature("\x00\x00\x00\xFF\xFF\x00\x00\x00");
+constexpr auto DTS_LONG_PART4             = signature("\x04\x00\x00\x23\x33\x00");
+
+// System UUID
+constexpr auto UUID_HEADER_6_SERIES       = signature("\x01\x08\x10\x00");
+constexpr auto UUID_HEADER_7_SERIES       = signature("\x01\x08\x00\x80\x09\x10\x00\x01\x00");
+constexpr auto UUID_HEADER_X79            = signature("\x01\x00\x00\x08\x10\x00\x00");
+#define UUID_LENGTH                         16
+
+// Motherboard S/N
+constexpr auto MBSN_HEADER_6_SERIES       = signature("\x02\x07\x10\x00");
+constexpr auto MBSN_HEADER_7_SERIES       = signature("\x02\x07\x00\x80\x09\x10\x00\x02\x00");
+constexpr auto MBSN_HEADER_X79            = signature("\x02\x00\x00\x07\x10\x00\x00");
+#define MBSN_BODY_LENGTH                    16
+
+// BIOS data structures
+enum bios_state_e {ParseError, Empty, Valid, HasNotDetectedValues};
+enum mac_e {UUID, ASCII, GbE, MacNotDetected};
+enum dts_e {None, Short, Long, DtsNotDetected};
+enum me_e {ME_15M, ME_3M, ME_5M};
+
+// Header variant used for FD44 module field
+enum header_e {NoHeader, Header6Series, Header7Series, HeaderX79};
+
+// Fixed-size fields of bios_t, field is present if its bit is set in bios_t::fields
+enum bios_field_e {MotherboardNameField, RecoveryNameField, BiosDateField, BiosVersionField,
+                   MeVersionField, GbeVersionField, ModuleVersionField, MacField, MacMagicField,
+                   DtsKeyField, DtsMagicField, UuidField, MbsnField, BiosFieldCount};
+
+// Parsing result, all fields are stored inline, so the record is copied
+// without allocations and can be written out as is.
+// Text fields are zero-padded, binary fields are valid only if present.
+typedef struct {
+// BIOS info
+char motherboard_name[BOOTEFI_MOTHERBOARD_NAME_LENGTH];
+char recovery_name[BOOTEFI_RECOVERY_NAME_LENGTH];
+char bios_date[BOOTEFI_BIOS_DATE_LENGTH];
+uint8_t bios_version[BOOTEFI_BIOS_VERSION_LENGTH];
+uint8_t me_version[ME_VERSION_LENGTH];
+uint8_t module_version[MODULE_VERSION_LENGTH];
+uint8_t gbe_version[GBE_VERSION_LENGTH];
+// MAC
+uint8_t mac[MAC_LENGTH];
+uint8_t mac_magic[ASCII_MAC_MAGIC_LENGTH];
+// DTS key
+uint8_t dts_key[DTS_KEY_LENGTH];
+uint8_t dts_magic[DTS_LONG_MAGIC_LENGTH];
+// UUID without MAC part, MAC is written after it
+uint8_t uuid[UUID_LENGTH - MAC_LENGTH];
+// MBSN without terminating zero
+char mbsn[MBSN_BODY_LENGTH - 1];
+// Present fields, bit per bios_field_e
+uint16_t fields;
+// Types, stored as bytes to keep the record small
+uint8_t me_type;            // me_e
+uint8_t mac_type;           // mac_e
+uint8_t dts_type;           // dts_e
+uint8_t mac_header;         // header_e
+uint8_t dts_short_header;   // header_e
+uint8_t dts_long_header;    // header_e
+uint8_t uuid_header;        // header_e
+uint8_t mbsn_header;        // header_e
+// BIOS state
+uint8_t state;              // bios_state_e
+} bios_t;
+
+#endif // BIOS_H
@@ -0,0 +1,50 @@
+/* bloomfilter.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#include "bloomfilter.h"
+
+// Bit positions are made from two halves of value hash,
+// so value is hashed only once
+static uint64_t bitIndex(uint64_t hash, int i, uint64_t bitCount)
+{
+    uint64_t step = (hash >> 32 | hash << 32) | 1;
+    return (hash + i * step) % bitCount;
+}
+
+size_t BloomFilter::size(size_t count)
+{
+    return (count * BLOOM_FILTER_BITS_PER_VALUE + 63) / 64 * 8 + 8;
+}
+
+void BloomFilter::add(uint8_t *bits, size_t size, uint64_t hash)
+{
+    for (int i = 0; i < BLOOM_FILTER_HASH_COUNT; i++)
+    {
+        uint64_t bit = bitIndex(hash, i, (uint64_t)size * 8);
+        bits[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+bool BloomFilter::mightContain(const ByteView & bits, uint64_t hash)
+{
+    if (bits.isEmpty())
+        return false;
+    for (int i = 0; i < BLOOM_FILTER_HASH_COUNT; i++)
+    {
+        uint64_t bit = bitIndex(hash, i, (uint64_t)bits.size() * 8);
+        if (!(bits.at((int)(bit / 8)) & (1 << (bit % 8))))
+            return false;
+    }
+    return true;
+}
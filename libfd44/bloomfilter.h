@@ -0,0 +1,40 @@
+/* bloomfilter.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byteview.h"
+
+// Bloom filter over 64-bit value hashes, about 1% false positives
+// when sized for number of values added. Bits are tested in place,
+// so filter stored in memory-mapped file is not copied.
+#define BLOOM_FILTER_BITS_PER_VALUE         10
+#define BLOOM_FILTER_HASH_COUNT             7
+
+class BloomFilter
+{
+public:
+    // Filter size in bytes for number of values, never zero
+    static size_t size(size_t count);
+
+    static void add(uint8_t *bits, size_t size, uint64_t hash);
+    // False means value was never added
+    static bool mightContain(const ByteView & bits, uint64_t hash);
+};
+
+#endif // BLOOMFILTER_H
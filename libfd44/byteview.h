@@ -0,0 +1,104 @@
+/* byteview.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef BYTEVIEW_H
+#define BYTEVIEW_H
+
+#include <stdint.h>
+#include <string.h>
+#include <array>
+
+// Non-owning view of image bytes.
+// Parser walks image through views, so no memory is allocated
+// until a field is copied to parsing result.
+class ByteView
+{
+public:
+    ByteView() : ptr(0), len(0) {}
+    ByteView(const char *data, int size) : ptr(data), len(size) {}
+    ByteView(const uint8_t *data, size_t size) : ptr((const char*)data), len((int)size) {}
+    template <size_t N> ByteView(const std::array<uint8_t, N> & bytes) : ptr((const char*)bytes.data()), len(N) {}
+
+    const char* data() const { return ptr; }
+    int size() const { return len; }
+    bool isEmpty() const { return len == 0; }
+    unsigned char at(int i) const { return (unsigned char)ptr[i]; }
+
+    // Subview, clamped to view bounds like QByteArray::mid
+    ByteView mid(int pos, int length = -1) const
+    {
+        if (pos < 0)
+        {
+            if (length >= 0)
+                length += pos;
+            pos = 0;
+        }
+        if (pos > len)
+            pos = len;
+        if (length < 0 || length > len - pos)
+            length = len - pos;
+        return ByteView(ptr + pos, length);
+    }
+
+    // Finds first occurrence of bytes at or after from, -1 if not found
+    int indexOf(const char *bytes, int length, int from = 0) const
+    {
+        if (from < 0)
+            from = 0;
+        if (length <= 0 || length > len)
+            return length == 0 && from <= len ? from : -1;
+
+        const char *end = ptr + len - length + 1;
+        for (const char *p = ptr + from; p < end; p++)
+        {
+            p = (const char*)memchr(p, bytes[0], end - p);
+            if (!p)
+                return -1;
+            if (!memcmp(p, bytes, length))
+                return (int)(p - ptr);
+        }
+        return -1;
+    }
+
+    // Checks that bytes are present at pos
+    bool matches(int pos, const char *bytes, int length) const
+    {
+        return pos >= 0 && length <= len - pos && !memcmp(ptr + pos, bytes, length);
+    }
+
+    // Number of bytes equal to c
+    int count(char c) const
+    {
+        int result = 0;
+        for (int i = 0; i < len; i++)
+            result += (ptr[i] == c);
+        return result;
+    }
+
+    int indexOf(const ByteView & bytes, int from = 0) const
+    {
+        return indexOf(bytes.data(), bytes.size(), from);
+    }
+
+    // Compare with signature of compile-time length, expanded inline
+    template <size_t N> bool matches(int pos, const std::array<uint8_t, N> & bytes) const
+    {
+        return pos >= 0 && (int)N <= len - pos && !memcmp(ptr + pos, bytes.data(), N);
+    }
+
+private:
+    const char *ptr;
+    int len;
+};
+
+#endif // BYTEVIEW_H
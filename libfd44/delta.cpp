@@ -0,0 +1,196 @@
+/* delta.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+
+#include "delta.h"
+
+// Equal bytes between changed runs are stored if that is shorter than new entry
+#define DELTA_MERGE_GAP     DELTA_ENTRY_HEADER_LENGTH
+
+static void appendUint32(std::vector<uint8_t> & data, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        data.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static uint32_t readUint32(const ByteView & data, int pos)
+{
+    return (uint32_t)data.at(pos) | (uint32_t)data.at(pos + 1) << 8 |
+           (uint32_t)data.at(pos + 2) << 16 | (uint32_t)data.at(pos + 3) << 24;
+}
+
+static bool entryLess(const delta_entry_t & a, const delta_entry_t & b)
+{
+    return a.offset < b.offset;
+}
+
+// Appends runs of patch bytes that differ from base ones
+static void addRuns(const ByteView & base, const image_patch_t & patch, std::vector<delta_entry_t> & entries)
+{
+    int length = (int)patch.data.size();
+    int i = 0;
+    while (i < length)
+    {
+        if (base.at(patch.offset + i) == patch.data[i])
+        {
+            i++;
+            continue;
+        }
+
+        // Run ends after DELTA_MERGE_GAP equal bytes or at patch end
+        int start = i, end = i + 1, equal = 0;
+        for (i++; i < length && equal < DELTA_MERGE_GAP; i++)
+        {
+            if (base.at(patch.offset + i) == patch.data[i])
+                equal++;
+            else
+            {
+                equal = 0;
+                end = i + 1;
+            }
+        }
+
+        delta_entry_t entry;
+        entry.offset = patch.offset + start;
+        entry.data.assign(patch.data.begin() + start, patch.data.begin() + end);
+        Sha256::hash(base.data() + entry.offset, entry.data.size(), entry.old_hash);
+        entries.push_back(entry);
+        i = end;
+    }
+}
+
+void ImageDelta::build(const ByteView & base, const std::vector<image_patch_t> & patches, image_delta_t & delta)
+{
+    delta.base_size = base.size();
+    delta.entries.clear();
+    for (size_t i = 0; i < patches.size(); i++)
+        addRuns(base, patches[i], delta.entries);
+    std::sort(delta.entries.begin(), delta.entries.end(), entryLess);
+
+    Sha256::hash(base.data(), base.size(), delta.base_hash);
+
+    // Result is hashed as base with entries put over it
+    Sha256 result;
+    int pos = 0;
+    for (size_t i = 0; i < delta.entries.size(); i++)
+    {
+        const delta_entry_t & entry = delta.entries[i];
+        result.update(base.data() + pos, entry.offset - pos);
+        result.update(entry.data.data(), entry.data.size());
+        pos = entry.offset + (int)entry.data.size();
+    }
+    result.update(base.data() + pos, base.size() - pos);
+    result.final(delta.result_hash);
+}
+
+void ImageDelta::write(const image_delta_t & delta, std::vector<uint8_t> & data)
+{
+    data.assign(DELTA_SIGNATURE.begin(), DELTA_SIGNATURE.end());
+    appendUint32(data, delta.base_size);
+    data.insert(data.end(), delta.base_hash, delta.base_hash + SHA256_LENGTH);
+    data.insert(data.end(), delta.result_hash, delta.result_hash + SHA256_LENGTH);
+    appendUint32(data, (uint32_t)delta.entries.size());
+
+    for (size_t i = 0; i < delta.entries.size(); i++)
+    {
+        const delta_entry_t & entry = delta.entries[i];
+        appendUint32(data, entry.offset);
+        appendUint32(data, (uint32_t)entry.data.size());
+        data.insert(data.end(), entry.old_hash, entry.old_hash + SHA256_LENGTH);
+        data.insert(data.end(), entry.data.begin(), entry.data.end());
+    }
+}
+
+bool ImageDelta::read(const ByteView & data, image_delta_t & delta)
+{
+    delta.entries.clear();
+    if (data.size() < DELTA_HEADER_LENGTH || !data.matches(0, DELTA_SIGNATURE))
+        return false;
+
+    int pos = DELTA_SIGNATURE.size();
+    uint32_t baseSize = readUint32(data, pos);
+    if (baseSize > 0x7FFFFFFF)
+        return false;
+    delta.base_size = (int)baseSize;
+    pos += 4;
+    memcpy(delta.base_hash, data.data() + pos, SHA256_LENGTH);
+    pos += SHA256_LENGTH;
+    memcpy(delta.result_hash, data.data() + pos, SHA256_LENGTH);
+    pos += SHA256_LENGTH;
+    uint32_t count = readUint32(data, pos);
+    pos += 4;
+
+    // Entries must be sorted, not overlapping and inside of base image
+    int end = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (data.size() - pos < DELTA_ENTRY_HEADER_LENGTH)
+            return false;
+        uint32_t offset = readUint32(data, pos);
+        uint32_t length = readUint32(data, pos + 4);
+        if (offset < (uint32_t)end || offset > baseSize || length > baseSize - offset
+            || length > (uint32_t)(data.size() - pos - DELTA_ENTRY_HEADER_LENGTH))
+            return false;
+
+        delta_entry_t entry;
+        entry.offset = (int)offset;
+        memcpy(entry.old_hash, data.data() + pos + 8, SHA256_LENGTH);
+        pos += DELTA_ENTRY_HEADER_LENGTH;
+        entry.data.assign(data.data() + pos, data.data() + pos + length);
+        pos += (int)length;
+        end = (int)(offset + length);
+        delta.entries.push_back(entry);
+    }
+    return pos == data.size();
+}
+
+delta_match_e ImageDelta::match(const ByteView & image, const image_delta_t & delta)
+{
+    if (image.size() != delta.base_size)
+        return DeltaMismatch;
+
+    uint8_t hash[SHA256_LENGTH];
+    Sha256::hash(image.data(), image.size(), hash);
+    if (!memcmp(hash, delta.base_hash, SHA256_LENGTH))
+        return DeltaBase;
+    if (!memcmp(hash, delta.result_hash, SHA256_LENGTH))
+        return DeltaResult;
+    return DeltaMismatch;
+}
+
+int ImageDelta::firstChangedEntry(const ByteView & image, const image_delta_t & delta)
+{
+    for (size_t i = 0; i < delta.entries.size(); i++)
+    {
+        const delta_entry_t & entry = delta.entries[i];
+        uint8_t hash[SHA256_LENGTH];
+        if (entry.offset + (int)entry.data.size() > image.size())
+            return (int)i;
+        Sha256::hash(image.data() + entry.offset, entry.data.size(), hash);
+        if (memcmp(hash, entry.old_hash, SHA256_LENGTH))
+            return (int)i;
+    }
+    return -1;
+}
+
+void ImageDelta::toPatches(const image_delta_t & delta, std::vector<image_patch_t> & patches)
+{
+    patches.resize(delta.entries.size());
+    for (size_t i = 0; i < delta.entries.size(); i++)
+    {
+        patches[i].offset = delta.entries[i].offset;
+        patches[i].data = delta.entries[i].data;
+    }
+}
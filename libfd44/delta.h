@@ -0,0 +1,70 @@
+/* delta.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "bios.h"
+#include "byteview.h"
+#include "fd44image.h"
+#include "sha256.h"
+
+// Delta file, all numbers are little-endian:
+// signature, base image size, base and result SHA-256, entry count,
+// then every entry as offset, length, SHA-256 of replaced bytes and new bytes
+constexpr auto DELTA_SIGNATURE            = signature("FD44DLT1");
+#define DELTA_HEADER_LENGTH                 (8 + 4 + 2 * SHA256_LENGTH + 4)
+#define DELTA_ENTRY_HEADER_LENGTH           (4 + 4 + SHA256_LENGTH)
+
+// Replaced byte run
+typedef struct {
+    int offset;
+    uint8_t old_hash[SHA256_LENGTH];
+    std::vector<uint8_t> data;
+} delta_entry_t;
+
+typedef struct {
+    int base_size;
+    uint8_t base_hash[SHA256_LENGTH];
+    uint8_t result_hash[SHA256_LENGTH];
+    std::vector<delta_entry_t> entries;     // sorted by offset, not overlapping
+} image_delta_t;
+
+// Image state relative to delta
+enum delta_match_e {DeltaBase, DeltaResult, DeltaMismatch};
+
+// Binary delta between base image and image written by FD44Image::buildPatches.
+// Only runs of changed bytes are stored, so delta of personalized image takes
+// hundreds of bytes instead of whole image.
+class ImageDelta
+{
+public:
+    // Builds delta from patches computed for base image
+    static void build(const ByteView & base, const std::vector<image_patch_t> & patches, image_delta_t & delta);
+
+    static void write(const image_delta_t & delta, std::vector<uint8_t> & data);
+    // Returns false if data is not a complete delta with entries inside of base image
+    static bool read(const ByteView & data, image_delta_t & delta);
+
+    // Hashes image once and compares it with both base and result
+    static delta_match_e match(const ByteView & image, const image_delta_t & delta);
+    // Returns first entry whose replaced bytes differ from image ones, -1 if there is none
+    static int firstChangedEntry(const ByteView & image, const image_delta_t & delta);
+
+    static void toPatches(const image_delta_t & delta, std::vector<image_patch_t> & patches);
+};
+
+#endif // DELTA_H
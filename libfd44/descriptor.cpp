@@ -0,0 +1,57 @@
+/* descriptor.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <string.h>
+
+#include "descriptor.h"
+
+static uint32_t readUint32(const ByteView & image, int pos)
+{
+    return (uint32_t)image.at(pos) | (uint32_t)image.at(pos + 1) << 8 |
+           (uint32_t)image.at(pos + 2) << 16 | (uint32_t)image.at(pos + 3) << 24;
+}
+
+bool FlashDescriptor::read(const ByteView & image, flash_map_t & map)
+{
+    memset(&map, 0, sizeof(map));
+
+    if (image.size() < FLASH_DESCRIPTOR_SIZE || readUint32(image, FLASH_DESCRIPTOR_SIGNATURE_OFFSET) != FLASH_DESCRIPTOR_SIGNATURE)
+        return false;
+
+    // FLMAP0: FRBA in bits 16-23, in 16-byte units
+    uint32_t flmap0 = readUint32(image, FLASH_DESCRIPTOR_FLMAP0_OFFSET);
+    int frba = (int)((flmap0 >> 16) & 0xFF) << 4;
+    if (frba + FlashRegionCount * 4 > FLASH_DESCRIPTOR_SIZE)
+        return false;
+
+    for (int i = 0; i < FlashRegionCount; i++)
+    {
+        // FLREG: base in bits 0-14, limit in bits 16-30, region is unused if base is above limit
+        uint32_t flreg = readUint32(image, frba + i * 4);
+        int base = (int)(flreg & 0x7FFF);
+        int limit = (int)((flreg >> 16) & 0x7FFF);
+        if (base > limit)
+            continue;
+
+        long long offset = (long long)base * FLASH_REGION_GRANULARITY;
+        long long end = ((long long)limit + 1) * FLASH_REGION_GRANULARITY;
+        if (end > image.size())
+            return false;
+
+        map.regions[i].offset = (int)offset;
+        map.regions[i].size = (int)(end - offset);
+    }
+
+    // Descriptor region must describe itself
+    return map.regions[DescriptorRegion].offset == 0 && map.regions[DescriptorRegion].size > 0;
+}
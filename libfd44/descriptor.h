@@ -0,0 +1,52 @@
+/* descriptor.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef DESCRIPTOR_H
+#define DESCRIPTOR_H
+
+#include <stdint.h>
+
+#include "byteview.h"
+
+// Intel flash descriptor
+#define FLASH_DESCRIPTOR_SIGNATURE          0x0FF0A55A
+#define FLASH_DESCRIPTOR_SIGNATURE_OFFSET   0x10
+#define FLASH_DESCRIPTOR_FLMAP0_OFFSET      0x14
+#define FLASH_DESCRIPTOR_SIZE               0x1000
+// FLREG base and limit are stored in 4 KB units
+#define FLASH_REGION_GRANULARITY            0x1000
+
+// Regions in FLREG order
+enum flash_region_e {DescriptorRegion, BiosRegion, MeRegion, GbeRegion, PdrRegion, FlashRegionCount};
+
+// Byte range of flash region, size is 0 for unused region
+typedef struct {
+    int offset;
+    int size;
+} flash_range_t;
+
+typedef struct {
+    flash_range_t regions[FlashRegionCount];
+} flash_map_t;
+
+// Flash descriptor parser.
+// Full SPI dumps start with descriptor, its FLREG entries give exact region bounds.
+// BIOS region dumps and capsules have no descriptor.
+class FlashDescriptor
+{
+public:
+    // Returns false if image has no valid descriptor or any region is out of image bounds
+    static bool read(const ByteView & image, flash_map_t & map);
+};
+
+#endif // DESCRIPTOR_H
@@ -0,0 +1,240 @@
+/* dupindex.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "bloomfilter.h"
+#include "dupindex.h"
+#include "fd44image.h"
+#include "xxhash.h"
+
+static void appendUint(std::vector<uint8_t> & data, uint64_t value, int length)
+{
+    for (int i = 0; i < length; i++)
+        data.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static uint64_t readUint(const ByteView & data, int pos, int length)
+{
+    uint64_t value = 0;
+    for (int i = length - 1; i >= 0; i--)
+        value = value << 8 | data.at(pos + i);
+    return value;
+}
+
+// Field number is hash seed, so equal bytes of different fields are different values
+static uint64_t valueHash(const duplicate_entry_t & entry)
+{
+    return XxHash64::hash(entry.value, DUPLICATE_VALUE_LENGTH, entry.field);
+}
+
+static void appendEntry(std::vector<uint8_t> & data, const duplicate_entry_t & entry)
+{
+    data.push_back(entry.field);
+    data.insert(data.end(), entry.value, entry.value + DUPLICATE_VALUE_LENGTH);
+    appendUint(data, entry.path, 4);
+}
+
+// All bytes are 0x00 or 0xFF
+static bool isBlank(const ByteView & value)
+{
+    return value.count('\x00') == value.size() || value.count('\xFF') == value.size();
+}
+
+DuplicateIndex::DuplicateIndex()
+    : numEntries(0), numPaths(0)
+{
+}
+
+void DuplicateIndex::entries(const bios_t & bios, uint32_t path, std::vector<duplicate_entry_t> & entries)
+{
+    static const bios_field_e fields[DuplicateFieldCount] = {MacField, UuidField, MbsnField};
+
+    if (bios.state == ParseError || bios.state == Empty)
+        return;
+
+    for (int i = 0; i < DuplicateFieldCount; i++)
+    {
+        ByteView value = FD44Image::field(bios, fields[i]);
+        if (value.isEmpty())
+            continue;
+
+        duplicate_entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.field = (uint8_t)i;
+        memcpy(entry.value, value.data(), std::min(value.size(), DUPLICATE_VALUE_LENGTH));
+
+        // UUID field has no MAC part, full UUID is compared, as boards
+        // of one model can share UUID part before MAC
+        if (i == DuplicateUuid)
+        {
+            ByteView mac = FD44Image::field(bios, MacField);
+            memcpy(entry.value + value.size(), mac.data(), std::min(mac.size(), DUPLICATE_VALUE_LENGTH - value.size()));
+        }
+        if (isBlank(ByteView(entry.value, i == DuplicateUuid ? (size_t)UUID_LENGTH : (size_t)value.size())))
+            continue;
+
+        entry.path = path;
+        entries.push_back(entry);
+    }
+}
+
+bool DuplicateIndex::lessThan(const duplicate_entry_t & a, const duplicate_entry_t & b)
+{
+    if (a.field != b.field)
+        return a.field < b.field;
+    return memcmp(a.value, b.value, DUPLICATE_VALUE_LENGTH) < 0;
+}
+
+bool DuplicateIndex::open(const ByteView & data)
+{
+    *this = DuplicateIndex();
+    if (data.size() < DUPLICATE_INDEX_HEADER_LENGTH || !data.matches(0, DUPLICATE_INDEX_SIGNATURE))
+        return false;
+
+    uint64_t bloomSize = readUint(data, 8, 4);
+    uint64_t entries = readUint(data, 12, 4);
+    uint64_t paths = readUint(data, 16, 4);
+    uint64_t pathStart = DUPLICATE_INDEX_HEADER_LENGTH + bloomSize + entries * DUPLICATE_ENTRY_LENGTH + paths * 4;
+    if (bloomSize == 0 || pathStart > (uint64_t)data.size())
+        return false;
+
+    bloom = data.mid(DUPLICATE_INDEX_HEADER_LENGTH, (int)bloomSize);
+    entryData = data.mid(DUPLICATE_INDEX_HEADER_LENGTH + (int)bloomSize, (int)(entries * DUPLICATE_ENTRY_LENGTH));
+    offsetData = data.mid(DUPLICATE_INDEX_HEADER_LENGTH + (int)bloomSize + entryData.size(), (int)(paths * 4));
+    pathData = data.mid((int)pathStart);
+    numEntries = (uint32_t)entries;
+    numPaths = (uint32_t)paths;
+    return true;
+}
+
+duplicate_entry_t DuplicateIndex::entry(uint32_t i) const
+{
+    duplicate_entry_t entry;
+    int pos = (int)i * DUPLICATE_ENTRY_LENGTH;
+    entry.field = entryData.at(pos);
+    memcpy(entry.value, entryData.data() + pos + 1, DUPLICATE_VALUE_LENGTH);
+    entry.path = (uint32_t)readUint(entryData, pos + 1 + DUPLICATE_VALUE_LENGTH, 4);
+    return entry;
+}
+
+std::string DuplicateIndex::path(uint32_t number) const
+{
+    if (number >= numPaths)
+        return std::string();
+
+    uint64_t offset = readUint(offsetData, (int)number * 4, 4);
+    if (offset + 4 > (uint64_t)pathData.size())
+        return std::string();
+    uint64_t length = readUint(pathData, (int)offset, 4);
+    if (offset + 4 + length > (uint64_t)pathData.size())
+        return std::string();
+    return std::string(pathData.data() + offset + 4, (size_t)length);
+}
+
+void DuplicateIndex::find(const duplicate_entry_t & entry, std::vector<duplicate_entry_t> & found) const
+{
+    if (!BloomFilter::mightContain(bloom, valueHash(entry)))
+        return;
+
+    // First entry not less than searched one
+    uint32_t first = 0, count = numEntries;
+    while (count > 0)
+    {
+        uint32_t step = count / 2;
+        if (lessThan(this->entry(first + step), entry))
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+            count = step;
+    }
+
+    for (uint32_t i = first; i < numEntries; i++)
+    {
+        duplicate_entry_t current = this->entry(i);
+        if (lessThan(entry, current))
+            break;
+        found.push_back(current);
+    }
+}
+
+void DuplicateIndex::write(const DuplicateIndex & base, const std::vector<duplicate_entry_t> & added,
+                           const std::vector<std::string> & paths, std::vector<uint8_t> & data)
+{
+    // Base paths are renumbered in order of first use, paths without entries are dropped
+    std::unordered_set<std::string> replaced(paths.begin(), paths.end());
+    std::unordered_map<uint32_t, uint32_t> numbers;
+    std::vector<std::string> newPaths;
+    std::vector<duplicate_entry_t> entries;
+    entries.reserve(base.entryCount() + added.size());
+    for (uint32_t i = 0; i < base.entryCount(); i++)
+    {
+        duplicate_entry_t entry = base.entry(i);
+        std::unordered_map<uint32_t, uint32_t>::const_iterator it = numbers.find(entry.path);
+        if (it == numbers.end())
+        {
+            std::string path = base.path(entry.path);
+            uint32_t number = replaced.count(path) ? UINT32_MAX : (uint32_t)newPaths.size();
+            if (number != UINT32_MAX)
+                newPaths.push_back(path);
+            it = numbers.insert(std::make_pair(entry.path, number)).first;
+        }
+        if (it->second == UINT32_MAX)
+            continue;
+        entry.path = it->second;
+        entries.push_back(entry);
+    }
+
+    // Both parts are sorted, added entries follow base ones with the same value
+    size_t baseCount = entries.size();
+    uint32_t firstAdded = (uint32_t)newPaths.size();
+    newPaths.insert(newPaths.end(), paths.begin(), paths.end());
+    for (size_t i = 0; i < added.size(); i++)
+    {
+        entries.push_back(added[i]);
+        entries.back().path += firstAdded;
+    }
+    std::stable_sort(entries.begin() + baseCount, entries.end(), lessThan);
+    std::inplace_merge(entries.begin(), entries.begin() + baseCount, entries.end(), lessThan);
+
+    std::vector<uint8_t> bloom(BloomFilter::size(entries.size()), 0);
+    for (size_t i = 0; i < entries.size(); i++)
+        BloomFilter::add(bloom.data(), bloom.size(), valueHash(entries[i]));
+
+    data.clear();
+    data.insert(data.end(), DUPLICATE_INDEX_SIGNATURE.begin(), DUPLICATE_INDEX_SIGNATURE.end());
+    appendUint(data, bloom.size(), 4);
+    appendUint(data, entries.size(), 4);
+    appendUint(data, newPaths.size(), 4);
+    data.insert(data.end(), bloom.begin(), bloom.end());
+    for (size_t i = 0; i < entries.size(); i++)
+        appendEntry(data, entries[i]);
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < newPaths.size(); i++)
+    {
+        appendUint(data, offset, 4);
+        offset += 4 + (uint32_t)newPaths[i].size();
+    }
+    for (size_t i = 0; i < newPaths.size(); i++)
+    {
+        appendUint(data, newPaths[i].size(), 4);
+        data.insert(data.end(), newPaths[i].begin(), newPaths[i].end());
+    }
+}
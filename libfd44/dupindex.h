@@ -0,0 +1,86 @@
+/* dupindex.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#ifndef DUPINDEX_H
+#define DUPINDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "bios.h"
+#include "byteview.h"
+
+// Duplicate index file, all numbers are little-endian:
+// signature, Bloom filter size, entry count, path count, Bloom filter of entry values,
+// entries sorted by field and value, each as field, zero-padded value and path number,
+// path offsets from start of path data, then every path as length and UTF-8 path.
+constexpr auto DUPLICATE_INDEX_SIGNATURE  = signature("FD44DUP2");
+#define DUPLICATE_INDEX_HEADER_LENGTH       (8 + 4 + 4 + 4)
+#define DUPLICATE_VALUE_LENGTH              16
+#define DUPLICATE_ENTRY_LENGTH              (1 + DUPLICATE_VALUE_LENGTH + 4)
+
+// Fields that must be unique for every board
+enum duplicate_field_e {DuplicateMac, DuplicateUuid, DuplicateMbsn, DuplicateFieldCount};
+
+typedef struct {
+    uint8_t field;                          // duplicate_field_e
+    uint8_t value[DUPLICATE_VALUE_LENGTH];  // field value, zero-padded
+    uint32_t path;                          // number of image path
+} duplicate_entry_t;
+
+// MAC, UUID and MBSN values of image fleet with paths of their images.
+// Index is read in place from memory-mapped file: value is looked up
+// in Bloom filter first and only values that pass it are searched
+// in sorted entries, so checking a batch of images touches only
+// pages of values it finds, whatever the fleet size is.
+class DuplicateIndex
+{
+public:
+    DuplicateIndex();
+
+    // Present values of parsed image, empty module and blank values have none,
+    // UUID value is full UUID with MAC part
+    static void entries(const bios_t & bios, uint32_t path, std::vector<duplicate_entry_t> & entries);
+    // Entries order, by field and value only
+    static bool lessThan(const duplicate_entry_t & a, const duplicate_entry_t & b);
+
+    // Checks section sizes, data must stay valid while index is used,
+    // returns false and leaves index empty if data is not an index
+    bool open(const ByteView & data);
+
+    uint32_t entryCount() const { return numEntries; }
+    uint32_t pathCount() const { return numPaths; }
+    duplicate_entry_t entry(uint32_t i) const;
+    // Empty string for invalid path
+    std::string path(uint32_t number) const;
+
+    // Index entries with the same field and value as entry
+    void find(const duplicate_entry_t & entry, std::vector<duplicate_entry_t> & found) const;
+
+    // Writes base index merged with added entries, whose path numbers refer
+    // to added paths. Base entries of added paths are replaced by added ones.
+    static void write(const DuplicateIndex & base, const std::vector<duplicate_entry_t> & added,
+                      const std::vector<std::string> & paths, std::vector<uint8_t> & data);
+
+private:
+    ByteView bloom;
+    ByteView entryData;
+    ByteView offsetData;
+    ByteView pathData;
+    uint32_t numEntries;
+    uint32_t numPaths;
+};
+
+#endif // DUPINDEX_H
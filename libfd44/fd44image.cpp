@@ -0,0 +1,1033 @@
+/* fd44image.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "descriptor.h"
+#include "fd44image.h"
+#include "mefpt.h"
+#include "motherboards.h"
+#include "scanner.h"
+#include "volume.h"
+
+// Signatures searched in the whole image, order must match buildImageScanner()
+enum image_signature_e {BootefiSignature, MeSignature, GbeSignature, ModuleSignature, VolumeSignature};
+
+static SignatureScanner buildImageScanner()
+{
+    SignatureScanner scanner;
+    scanner.addSignature(BOOTEFI_HEADER);
+    scanner.addSignature(ME_HEADER);
+    scanner.addSignature(GBE_HEADER);
+    scanner.addSignature(MODULE_HEADER);
+    scanner.addSignature(FV_SIGNATURE);
+    scanner.build();
+    return scanner;
+}
+
+// Region each signature belongs to in full flash dumps
+static const flash_region_e SIGNATURE_REGIONS[] = {BiosRegion, MeRegion, GbeRegion, BiosRegion, BiosRegion};
+
+// Replaces module signature hits with FD44 files found by walking valid firmware volumes.
+// GUID bytes inside compressed data or outside of file headers are not accepted then.
+// Images without valid volumes or with modules only in compressed volumes keep signature hits.
+static void walkVolumes(const ByteView & image, std::vector<hits_t> & hits)
+{
+    std::vector<ffs_file_t> files;
+    const hits_t & volumes = hits[VolumeSignature];
+    for (size_t i = 0; i < volumes.size(); i++)
+    {
+        int offset = volumes[i] - FV_SIGNATURE_OFFSET;
+        if (!FirmwareVolume::isValid(image, offset))
+            continue;
+        FirmwareVolume::findFiles(image, offset, MODULE_HEADER, files);
+    }
+    if (files.empty())
+        return;
+
+    // Nested volumes are walked separately, so every file is found once
+    hits_t & modules = hits[ModuleSignature];
+    modules.clear();
+    for (size_t i = 0; i < files.size(); i++)
+        modules.push_back(files[i].offset);
+    std::sort(modules.begin(), modules.end());
+}
+
+// Finds all image signatures.
+// Full flash dumps are scanned region by region and every signature is accepted
+// only in its own region, so GbE or ME bytes in other regions give no false hits.
+// Descriptor and platform data regions are skipped.
+// Images without descriptor are scanned in single pass, their region map is empty.
+static void scanImage(const ByteView & image, flash_map_t & map, std::vector<hits_t> & hits)
+{
+    static const SignatureScanner scanner = buildImageScanner();
+
+    if (!FlashDescriptor::read(image, map))
+    {
+        scanner.scan(image.data(), image.size(), hits);
+        walkVolumes(image, hits);
+        return;
+    }
+
+    const flash_region_e regions[] = {MeRegion, GbeRegion, BiosRegion};
+    hits.assign(sizeof(SIGNATURE_REGIONS) / sizeof(SIGNATURE_REGIONS[0]), hits_t());
+    std::vector<hits_t> regionHits;
+    for (size_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++)
+    {
+        const flash_range_t & range = map.regions[regions[r]];
+        if (range.size == 0)
+            continue;
+
+        scanner.scan(image.data() + range.offset, range.size, regionHits);
+        for (size_t i = 0; i < hits.size(); i++)
+        {
+            if (SIGNATURE_REGIONS[i] != regions[r])
+                continue;
+            for (size_t j = 0; j < regionHits[i].size(); j++)
+                hits[i].push_back(regionHits[i][j] + range.offset);
+        }
+    }
+    walkVolumes(image, hits);
+}
+
+// Perfect hash of supported board names.
+// Seed that maps all names to different slots is found at compile time,
+// so lookup is a single hash and name compare.
+#define MOTHERBOARD_HASH_SIZE 512
+
+constexpr uint32_t motherboardHash(const char *name, int length, uint32_t seed)
+{
+    // FNV-1a of name up to terminating zero
+    uint32_t hash = 2166136261u ^ seed;
+    for (int i = 0; i < length && name[i]; i++)
+    {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return (hash ^ (hash >> 16)) % MOTHERBOARD_HASH_SIZE;
+}
+
+struct motherboard_slots_t {
+    uint32_t seed;
+    uint8_t index[MOTHERBOARD_HASH_SIZE];
+};
+
+constexpr motherboard_slots_t buildMotherboardSlots()
+{
+    static_assert(SUPPORTED_MOTHERBOARDS_LIST_LENGTH < 0xFF, "Board index must fit in a byte");
+
+    motherboard_slots_t table = {0, {0}};
+    for (uint32_t seed = 0; seed < 0x10000; seed++)
+    {
+        for (int i = 0; i < MOTHERBOARD_HASH_SIZE; i++)
+            table.index[i] = 0xFF;
+
+        bool collision = false;
+        for (unsigned int i = 0; i < SUPPORTED_MOTHERBOARDS_LIST_LENGTH && !collision; i++)
+        {
+            uint32_t slot = motherboardHash(SUPPORTED_MOTHERBOARDS_LIST[i].name, BOOTEFI_MOTHERBOARD_NAME_LENGTH, seed);
+            collision = (table.index[slot] != 0xFF);
+            table.index[slot] = (uint8_t)i;
+        }
+        if (!collision)
+        {
+            table.seed = seed;
+            return table;
+        }
+    }
+    throw "No perfect hash seed found for board names";
+}
+
+constexpr motherboard_slots_t MOTHERBOARD_SLOTS = buildMotherboardSlots();
+
+// Returns index of board in SUPPORTED_MOTHERBOARDS_LIST, -1 if board is not supported
+static int findMotherboard(const ByteView & name)
+{
+    uint8_t index = MOTHERBOARD_SLOTS.index[motherboardHash(name.data(), name.size(), MOTHERBOARD_SLOTS.seed)];
+    if (index == 0xFF || strncmp(SUPPORTED_MOTHERBOARDS_LIST[index].name, name.data(), name.size()))
+        return -1;
+    return index;
+}
+
+// Location of bios_t fields, order must match bios_field_e
+typedef struct {
+    size_t offset;
+    int length;
+    bool text;
+} bios_field_t;
+
+static const bios_field_t BIOS_FIELDS[BiosFieldCount] = {
+    {offsetof(bios_t, motherboard_name), BOOTEFI_MOTHERBOARD_NAME_LENGTH, true},
+    {offsetof(bios_t, recovery_name), BOOTEFI_RECOVERY_NAME_LENGTH, true},
+    {offsetof(bios_t, bios_date), BOOTEFI_BIOS_DATE_LENGTH, true},
+    {offsetof(bios_t, bios_version), BOOTEFI_BIOS_VERSION_LENGTH, false},
+    {offsetof(bios_t, me_version), ME_VERSION_LENGTH, false},
+    {offsetof(bios_t, gbe_version), GBE_VERSION_LENGTH, false},
+    {offsetof(bios_t, module_version), MODULE_VERSION_LENGTH, false},
+    {offsetof(bios_t, mac), MAC_LENGTH, false},
+    {offsetof(bios_t, mac_magic), ASCII_MAC_MAGIC_LENGTH, false},
+    {offsetof(bios_t, dts_key), DTS_KEY_LENGTH, false},
+    {offsetof(bios_t, dts_magic), DTS_LONG_MAGIC_LENGTH, false},
+    {offsetof(bios_t, uuid), UUID_LENGTH - MAC_LENGTH, false},
+    {offsetof(bios_t, mbsn), MBSN_BODY_LENGTH - 1, true}
+};
+
+// Stores field bytes, binary fields must have exact length
+static bool storeField(bios_t & bios, bios_field_e field, const char *data, int size)
+{
+    const bios_field_t & location = BIOS_FIELDS[field];
+    if (size > location.length || (size && !location.text && size != location.length))
+        return false;
+
+    char *dest = (char*)&bios + location.offset;
+    memset(dest, 0, location.length);
+    if (size)
+    {
+        memcpy(dest, data, size);
+        bios.fields |= 1 << field;
+    }
+    else
+        bios.fields &= ~(1 << field);
+    return true;
+}
+
+// Copies field referenced by view to parsing result
+static bool storeField(bios_t & bios, bios_field_e field, const ByteView & view)
+{
+    return storeField(bios, field, view.data(), view.size());
+}
+
+// Stores board table magic, missing magic removes field
+template <size_t N> static void storeMagic(bios_t & bios, bios_field_e field, const board_magic_t<N> & magic)
+{
+    if (magic.present)
+        storeField(bios, field, (const char*)magic.bytes.data(), N);
+    else
+        storeField(bios, field, 0, 0);
+}
+
+// Header bytes for header variant, empty if field has no such variant
+static ByteView header(header_e variant, const ByteView & series6, const ByteView & series7, const ByteView & x79)
+{
+    switch (variant)
+    {
+    case Header6Series:
+        return series6;
+    case Header7Series:
+        return series7;
+    case HeaderX79:
+        return x79;
+    default:
+        return ByteView();
+    }
+}
+
+static ByteView macHeader(const bios_t & bios)
+{
+    return header((header_e)bios.mac_header, ASCII_MAC_HEADER_6_SERIES, ASCII_MAC_HEADER_7_SERIES, ByteView());
+}
+
+static ByteView dtsShortHeader(const bios_t & bios)
+{
+    return header((header_e)bios.dts_short_header, DTS_SHORT_HEADER_6_SERIES, ByteView(), ByteView());
+}
+
+static ByteView dtsLongHeader(const bios_t & bios)
+{
+    return header((header_e)bios.dts_long_header, DTS_LONG_HEADER_6_SERIES, DTS_LONG_HEADER_7_SERIES, DTS_LONG_HEADER_X79);
+}
+
+static ByteView uuidHeader(const bios_t & bios)
+{
+    return header((header_e)bios.uuid_header, UUID_HEADER_6_SERIES, UUID_HEADER_7_SERIES, UUID_HEADER_X79);
+}
+
+static ByteView mbsnHeader(const bios_t & bios)
+{
+    return header((header_e)bios.mbsn_header, MBSN_HEADER_6_SERIES, MBSN_HEADER_7_SERIES, MBSN_HEADER_X79);
+}
+
+// Index of module version in MODULE_VERSIONS, -1 for unknown version
+static int moduleVersionIndex(uint8_t version)
+{
+    for (size_t i = 0; i < MODULE_VERSIONS.size(); i++)
+    {
+        if (MODULE_VERSIONS[i] == version)
+            return (int)i;
+    }
+    return -1;
+}
+
+// Appends signature or image bytes to module data
+static void append(std::vector<uint8_t> & module, const ByteView & bytes)
+{
+    module.insert(module.end(), (const uint8_t*)bytes.data(), (const uint8_t*)bytes.data() + bytes.size());
+}
+
+// Appends bytes as uppercase hex digits
+static void appendHex(std::vector<uint8_t> & module, const ByteView & bytes)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    for (int i = 0; i < bytes.size(); i++)
+    {
+        module.push_back(digits[bytes.at(i) >> 4]);
+        module.push_back(digits[bytes.at(i) & 0x0F]);
+    }
+}
+
+static int hexDigit(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes length bytes from hex digits, false if text is too short or not hex
+static bool decodeHex(const ByteView & text, uint8_t *bytes, int length)
+{
+    if (text.size() < length * 2)
+        return false;
+
+    for (int i = 0; i < length; i++)
+    {
+        int high = hexDigit(text.at(2 * i));
+        int low = hexDigit(text.at(2 * i + 1));
+        if (high < 0 || low < 0)
+            return false;
+        bytes[i] = (uint8_t)(high << 4 | low);
+    }
+    return true;
+}
+
+static image_status_t status(image_error_e error, int offset)
+{
+    image_status_t result;
+    result.error = error;
+    result.offset = offset;
+    return result;
+}
+
+// Marks parsing result as failed
+static image_status_t fail(bios_t & bios, image_error_e error, int offset)
+{
+    bios.state = ParseError;
+    return status(error, offset);
+}
+
+// Reads 24-bit module length, 0 if module header is truncated
+static int readModuleLength(const ByteView & image, int pos)
+{
+    if (pos < 0 || pos + MODULE_LENGTH_OFFSET + 3 > image.size())
+        return 0;
+    return (image.at(pos + MODULE_LENGTH_OFFSET + 2) << 16) +
+           (image.at(pos + MODULE_LENGTH_OFFSET + 1) << 8)  +
+            image.at(pos + MODULE_LENGTH_OFFSET);
+}
+
+// Accumulates time of parsing stages, does nothing without profile
+class StageClock
+{
+public:
+    explicit StageClock(read_profile_t *profile) : profile(profile)
+    {
+        if (!profile)
+            return;
+        memset(profile, 0, sizeof(read_profile_t));
+        last = std::chrono::steady_clock::now();
+    }
+
+    // Adds time since previous stage end to given stage
+    void stop(read_stage_e stage)
+    {
+        if (!profile)
+            return;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        profile->nsecs[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        last = now;
+    }
+
+private:
+    read_profile_t *profile;
+    std::chrono::steady_clock::time_point last;
+};
+
+int FD44Image::capsuleOffset(const ByteView & image)
+{
+    if (image.size() < (int)sizeof(APTIO_CAPSULE_HEADER) || !image.matches(0, APTIO_CAPSULE_GUID))
+        return 0;
+
+    const APTIO_CAPSULE_HEADER *header = (const APTIO_CAPSULE_HEADER*) image.data();
+    if (header->RomImageOffset > image.size())
+        return 0;
+
+    return header->RomImageOffset;
+}
+
+void FD44Image::scan(const ByteView & image, image_offsets_t & offsets)
+{
+    flash_map_t map;
+    std::vector<hits_t> hits;
+    scanImage(image, map, hits);
+    offsets.bootefi.swap(hits[BootefiSignature]);
+    offsets.me.swap(hits[MeSignature]);
+    offsets.gbe.swap(hits[GbeSignature]);
+    offsets.modules.swap(hits[ModuleSignature]);
+}
+
+// Checks that signature is present at every offset
+template <size_t N> static bool checkHits(const ByteView & image, const hits_t & hits, const signature_t<N> & signature)
+{
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        if (!image.matches(hits[i], signature))
+            return false;
+    }
+    return true;
+}
+
+bool FD44Image::checkOffsets(const ByteView & image, const image_offsets_t & offsets)
+{
+    return checkHits(image, offsets.bootefi, BOOTEFI_HEADER) && checkHits(image, offsets.me, ME_HEADER)
+        && checkHits(image, offsets.gbe, GBE_HEADER) && checkHits(image, offsets.modules, MODULE_HEADER);
+}
+
+image_status_t FD44Image::read(const ByteView & image, bios_t & bios, read_profile_t *profile)
+{
+    // Clock is read only for profile, scan time is stored after read() clears it
+    std::chrono::steady_clock::time_point start;
+    if (profile)
+        start = std::chrono::steady_clock::now();
+    image_offsets_t offsets;
+    scan(image, offsets);
+    int64_t scanTime = 0;
+    if (profile)
+        scanTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    image_status_t result = read(image, offsets, bios, profile);
+    if (profile)
+        profile->nsecs[ScanStage] = scanTime;
+    return result;
+}
+
+image_status_t FD44Image::read(const ByteView & image, const image_offsets_t & offsets, bios_t & bios, read_profile_t *profile)
+{
+    StageClock clock(profile);
+    memset(&bios, 0, sizeof(bios));
+
+	// Setting default values
+	bios.mac_type = MacNotDetected;
+
+    // Only region bounds are read from descriptor
+    flash_map_t map;
+    FlashDescriptor::read(image, map);
+
+    // Image is accessed through views, only resulting fields are copied
+
+    // Detecting motherboard model and BIOS version
+    int pos = SignatureScanner::lastHit(offsets.bootefi);
+    if (pos == -1)
+    {
+        return fail(bios, BootefiNotFound, -1);
+    }
+
+    pos += BOOTEFI_HEADER.size() + BOOTEFI_MAGIC_LENGTH;
+    storeField(bios, BiosVersionField, image.mid(pos, BOOTEFI_BIOS_VERSION_LENGTH));
+    pos += BOOTEFI_BIOS_VERSION_LENGTH;
+    ByteView motherboardName = image.mid(pos, BOOTEFI_MOTHERBOARD_NAME_LENGTH);
+    storeField(bios, MotherboardNameField, motherboardName);
+    pos += BOOTEFI_MOTHERBOARD_NAME_LENGTH + BOOTEFI_BIOS_DATE_OFFSET;
+    storeField(bios, BiosDateField, image.mid(pos, BOOTEFI_BIOS_DATE_LENGTH));
+	pos += BOOTEFI_BIOS_DATE_LENGTH + BOOTEFI_RECOVERY_NAME_OFFSET;
+	storeField(bios, RecoveryNameField, image.mid(pos, BOOTEFI_RECOVERY_NAME_LENGTH));
+
+    // Searching for that board in database
+    int dbIndex = findMotherboard(motherboardName);
+    clock.stop(BootefiStage);
+
+    // Detecting ME presence and version from partition table,
+    // ME region bounds it in full flash dumps and gives base of partition offsets,
+    // without descriptor region is assumed to start with ROM bypass vector before $FPT
+    const flash_range_t & meRegion = map.regions[MeRegion];
+    int meEnd = (meRegion.size > 0) ? meRegion.offset + meRegion.size : image.size();
+    me_firmware_t me;
+    const hits_t & tables = offsets.me;
+    for (size_t i = 0; i < tables.size(); i++)
+    {
+        int table = tables[i] + ME_HEADER.size() - ME_FPT_SIGNATURE_LENGTH;
+        int meStart = (meRegion.size > 0) ? meRegion.offset : table - ME_FPT_ROMB_LENGTH;
+        if (!MePartitionTable::read(image, table, meStart, meEnd, me))
+            continue;
+
+        bios.me_type = (uint8_t)me.type;
+        if (me.version != -1)
+            storeField(bios, MeVersionField, image.mid(me.version, ME_VERSION_LENGTH));
+        break;
+    }
+    clock.stop(MeStage);
+
+    // Detecting GbE presence and version
+    bool macFound = false;
+    pos = SignatureScanner::firstHit(offsets.gbe);
+    if (pos != -1)
+    {
+        int pos2 = SignatureScanner::lastHit(offsets.gbe);
+        if (pos != pos2 && image.matches(pos + GBE_MAC_OFFSET - MAC_LENGTH, GBE_MAC_STUB))
+            pos = pos2;
+
+        storeField(bios, MacField, image.mid(pos + GBE_MAC_OFFSET - MAC_LENGTH, MAC_LENGTH));
+        storeField(bios, GbeVersionField, image.mid(pos + GBE_VERSION_OFFSET, GBE_VERSION_LENGTH));
+        bios.mac_type = GbE;
+        macFound = true;
+    }
+    clock.stop(GbeStage);
+
+    // Searching for non-empty module
+    pos = SignatureScanner::firstHit(offsets.modules);
+    if (pos == -1)
+    {
+        return fail(bios, ModuleNotFound, -1);
+    }
+
+    bool isEmpty = true;
+    int moduleLength;
+    ByteView module, moduleBody;
+    while (isEmpty && pos != -1)
+    {
+        // Checking for BSA_ signature
+        if (!image.matches(pos + MODULE_HEADER_BSA_OFFSET, MODULE_HEADER_BSA))
+        {
+            pos = SignatureScanner::firstHit(offsets.modules, pos+1);
+            continue;
+        }
+        
+        // Reading module length
+        moduleLength = readModuleLength(image, pos);
+        module = image.mid(pos, moduleLength);
+
+        // Determining version
+        if (module.size() <= MODULE_VERSION_OFFSET || moduleVersionIndex(module.at(MODULE_VERSION_OFFSET)) < 0)
+        {
+            return fail(bios, ModuleVersionUnknown, pos + MODULE_VERSION_OFFSET);
+        }
+
+        // Setting up module structure depending on detected module version
+        // X79 motherboards have similar FD44 module header, but different data format.
+        bool x79board = (motherboardName.indexOf("X79", 3) != -1 || motherboardName.indexOf("Rampage-IV", 10) != -1);
+        
+		// C20x motherboards have similar FD44 module header, but different data format.
+		// TODO: replace detection algorithm, too many exclusions
+		bool c20xboard = (motherboardName.indexOf("P8B-", 4) != -1);
+		
+		storeField(bios, ModuleVersionField, module.mid(MODULE_VERSION_OFFSET, MODULE_VERSION_LENGTH));
+        switch (moduleVersionIndex(bios.module_version[0]))
+        {
+        case 0: // 6 series or X79 or C20x
+            if (x79board) // X79
+            {
+                bios.mac_header = NoHeader;
+                bios.dts_short_header = NoHeader;
+                bios.dts_long_header = HeaderX79;
+                bios.mbsn_header = HeaderX79;
+                bios.uuid_header = HeaderX79;
+            }
+			else if (c20xboard)	// C20x
+			{
+				bios.mac_header = NoHeader;
+				bios.dts_short_header = NoHeader;
+				bios.dts_long_header = NoHeader;
+				bios.mbsn_header = Header7Series;
+				bios.uuid_header = Header7Series;
+			}
+			else // 6 series
+			{
+                bios.mac_header = Header6Series;
+                bios.dts_short_header = Header6Series;
+                bios.dts_long_header = Header6Series;
+                bios.mbsn_header = Header6Series;
+                bios.uuid_header = Header6Series;
+            }
+            break;
+        case 1: // C602
+            bios.mac_header = NoHeader;
+            bios.dts_short_header = NoHeader;
+            bios.dts_long_header = NoHeader;
+            bios.mbsn_header = Header7Series;
+            bios.uuid_header = Header7Series;
+            break;
+        case 2: // 7 and 8 series
+            bios.mac_header = Header7Series;
+            bios.dts_short_header = NoHeader;
+            bios.dts_long_header = Header7Series;
+            bios.mbsn_header = Header7Series;
+            bios.uuid_header = Header7Series;
+            break;
+        case 3: // 9 series
+            bios.mac_header = Header7Series;
+            bios.dts_short_header = NoHeader;
+            bios.dts_long_header = NoHeader;
+            bios.mbsn_header = Header7Series;
+            bios.uuid_header = Header7Series;
+            break;
+        default:
+            return fail(bios, ModuleVersionUnsupported, pos + MODULE_VERSION_OFFSET);
+        }
+
+        pos += MODULE_HEADER_LENGTH;
+        
+        // Checking for empty module
+        moduleBody = module.mid(MODULE_HEADER_LENGTH);
+        if (moduleBody.count('\xFF') != moduleBody.size())
+            isEmpty = false;
+        else
+            pos = SignatureScanner::firstHit(offsets.modules, pos+1);
+    }
+    clock.stop(ModuleStage);
+
+    if (isEmpty)
+    {
+        // Trying to detect module data format from board database
+        if (dbIndex >= 0)
+        {
+            bios.mac_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_type;
+            storeMagic(bios, MacMagicField, SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_magic);
+            bios.dts_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_type;
+            storeMagic(bios, DtsMagicField, SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_magic);
+            bios.state = Empty;
+        }
+        else
+        {
+            storeField(bios, MacMagicField, 0, 0);
+            bios.dts_type = DtsNotDetected;
+            storeField(bios, DtsMagicField, 0, 0);
+            bios.state = HasNotDetectedValues;
+        }
+
+        return status(NoError, -1);
+    }
+
+    // Module body is searched through view, offsets in errors are image offsets
+    int bodyOffset = (int)(moduleBody.data() - image.data());
+
+    // Detecting MAC address type and value
+    // Searching for ASCII MAC
+    if (bios.mac_header != NoHeader && bios.mac_type != GbE)
+    {
+        ByteView macHeaderBytes = macHeader(bios);
+        pos = moduleBody.indexOf(macHeaderBytes);
+        if (pos != -1 )
+        {
+            pos += macHeaderBytes.size();
+
+            if (bios.mac_header == Header7Series)
+            {
+                storeField(bios, MacMagicField, moduleBody.mid(pos, ASCII_MAC_MAGIC_LENGTH));
+                pos += ASCII_MAC_OFFSET;
+            }
+
+            uint8_t mac[MAC_LENGTH];
+            if (decodeHex(moduleBody.mid(pos, ASCII_MAC_LENGTH), mac, MAC_LENGTH))
+                storeField(bios, MacField, (const char*)mac, MAC_LENGTH);
+            bios.mac_type = ASCII;
+            macFound = true;
+        }
+    }
+
+    if (!macFound)
+    {
+        if (dbIndex >= 0)
+        {
+            bios.mac_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_type;
+            storeMagic(bios, MacMagicField, SUPPORTED_MOTHERBOARDS_LIST[dbIndex].mac_magic);
+        }
+        else
+        {
+            bios.mac_type = MacNotDetected;
+            storeField(bios, MacMagicField, 0, 0);
+        }
+    }
+    clock.stop(AsciiMacStage);
+    
+    // Searching for DTS key
+    bool dtsFound = false;
+    // Searching for short DTS
+    if (bios.dts_short_header != NoHeader)
+    {
+        ByteView dtsHeaderBytes = dtsShortHeader(bios);
+        pos = moduleBody.indexOf(dtsHeaderBytes);
+        if (pos != -1)
+        {
+            pos += dtsHeaderBytes.size();
+            storeField(bios, DtsKeyField, moduleBody.mid(pos, DTS_KEY_LENGTH));
+            pos += DTS_KEY_LENGTH;
+
+            if (!moduleBody.matches(pos, DTS_SHORT_PART2))
+            {
+                return fail(bios, ShortDtsPart2Unknown, bodyOffset + pos);
+            }
+
+            bios.dts_type = Short;
+            dtsFound = true;
+        }
+    }
+    clock.stop(ShortDtsStage);
+
+    // Searching for long DTS
+    if (bios.dts_type != Short && bios.dts_long_header != NoHeader)
+    {
+        ByteView dtsHeaderBytes = dtsLongHeader(bios);
+        pos = moduleBody.indexOf(dtsHeaderBytes);
+        if (pos != -1)
+        {
+            pos += dtsHeaderBytes.size();
+            storeField(bios, DtsKeyField, moduleBody.mid(pos, DTS_KEY_LENGTH));
+            pos += DTS_KEY_LENGTH;
+
+            if (!moduleBody.matches(pos, DTS_LONG_PART2))
+            {
+                return fail(bios, LongDtsPart2Unknown, bodyOffset + pos);
+            }
+            pos += DTS_LONG_PART2.size();
+
+            storeField(bios, DtsMagicField, moduleBody.mid(pos, DTS_LONG_MAGIC_LENGTH));
+            pos += DTS_LONG_MAGIC_LENGTH;
+
+            if (!moduleBody.matches(pos, DTS_LONG_PART3))
+            {
+                return fail(bios, LongDtsPart3Unknown, bodyOffset + pos);
+            }
+            pos += DTS_LONG_PART3.size();
+
+            ByteView reversedKey = moduleBody.mid(pos, DTS_KEY_LENGTH);
+            bool reversed = (hasField(bios, DtsKeyField) && reversedKey.size() == DTS_KEY_LENGTH);
+            for(int i = 0; reversed && i < DTS_KEY_LENGTH; i++)
+            {
+                reversed = (bios.dts_key[i] == (reversedKey.at(DTS_KEY_LENGTH-1-i) ^ (unsigned char)DTS_LONG_MASK[i]));
+            }
+            if (!reversed)
+            {
+                return fail(bios, LongDtsKeyCorrupted, bodyOffset + pos);
+            }
+            pos += DTS_KEY_LENGTH;
+
+            if (!moduleBody.matches(pos, DTS_LONG_PART4))
+            {
+                return fail(bios, LongDtsPart4Unknown, bodyOffset + pos);
+            }
+
+            bios.dts_type = Long;
+            dtsFound = true;
+        }
+    }
+
+    if (!dtsFound)
+    {
+        if (dbIndex >= 0)
+        {
+            bios.dts_type = SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_type;
+            storeMagic(bios, DtsMagicField, SUPPORTED_MOTHERBOARDS_LIST[dbIndex].dts_magic);
+        }
+        else
+        {
+            bios.dts_type = DtsNotDetected;
+            storeField(bios, DtsMagicField, 0, 0);
+        }
+    }
+    clock.stop(LongDtsStage);
+
+    // Searching for UUID
+    if (bios.uuid_header != NoHeader)
+    {
+        ByteView uuidHeaderBytes = uuidHeader(bios);
+        pos = moduleBody.indexOf(uuidHeaderBytes);
+        if (pos == -1)
+        {
+            return fail(bios, UuidNotFound, bodyOffset);
+        }
+        pos += uuidHeaderBytes.size();
+        storeField(bios, UuidField, moduleBody.mid(pos, UUID_LENGTH - MAC_LENGTH));
+        
+        // MAC part of UUID
+        if (!macFound || bios.mac_type == UUID)
+        {
+            storeField(bios, MacField, moduleBody.mid(pos + UUID_LENGTH - MAC_LENGTH, MAC_LENGTH));
+        }
+    }
+    clock.stop(UuidStage);
+
+    // Searching for MBSN
+    if (bios.mbsn_header != NoHeader)
+    {
+        ByteView mbsnHeaderBytes = mbsnHeader(bios);
+        pos = moduleBody.indexOf(mbsnHeaderBytes);
+        if (pos == -1)
+        {
+            return fail(bios, MbsnNotFound, bodyOffset);
+        }
+        pos += mbsnHeaderBytes.size();
+        storeField(bios, MbsnField, moduleBody.mid(pos, MBSN_BODY_LENGTH - 1));
+    }
+    clock.stop(MbsnStage);
+
+    // Checking for not detected values
+    if (bios.mac_type == MacNotDetected || bios.dts_type == DtsNotDetected)
+        bios.state = HasNotDetectedValues;
+    else
+        bios.state = Valid;
+
+    return status(NoError, -1);
+}
+
+image_status_t FD44Image::buildPatches(const ByteView & image, const bios_t & bios, std::vector<image_patch_t> & patches)
+{
+    patches.clear();
+
+    patch_layout_t layout;
+    image_status_t result = buildLayout(image, bios, layout);
+    if (result.error != NoError)
+        return result;
+
+    return layoutPatches(image, layout, bios, patches);
+}
+
+// FD44 module body without FF tail
+static void moduleData(const bios_t & bios, std::vector<uint8_t> & module)
+{
+    module.clear();
+
+    // MAC
+    if (bios.mac_type == ASCII)
+    {
+        append(module, macHeader(bios));
+        if (bios.mac_header == Header7Series)
+        {
+            append(module, FD44Image::field(bios, MacMagicField));
+            module.push_back(0);
+        }
+        appendHex(module, FD44Image::field(bios, MacField));
+        module.push_back(0);
+    }
+   
+    // Short DTS key
+    if (bios.dts_type == Short)
+    {
+        append(module, dtsShortHeader(bios));
+        append(module, FD44Image::field(bios, DtsKeyField));
+        append(module, DTS_SHORT_PART2);
+    }
+
+    // Long DTS key
+    if (bios.dts_type == Long)
+    {
+        append(module, dtsLongHeader(bios));
+        append(module, FD44Image::field(bios, DtsKeyField));
+        append(module, DTS_LONG_PART2);
+        append(module, FD44Image::field(bios, DtsMagicField));
+        append(module, DTS_LONG_PART3);
+        for(unsigned int i = 0; i < DTS_KEY_LENGTH; i++)
+            module.push_back(bios.dts_key[DTS_KEY_LENGTH-1-i] ^ DTS_LONG_MASK[i]);
+        append(module, DTS_LONG_PART4);
+    }
+
+    // UUID
+    if (bios.uuid_header != NoHeader)
+    {
+        append(module, uuidHeader(bios));
+        append(module, FD44Image::field(bios, UuidField));
+        append(module, FD44Image::field(bios, MacField));
+    }
+
+    // MBSN
+    if (bios.mbsn_header != NoHeader)
+    {
+        append(module, mbsnHeader(bios));
+        append(module, ByteView(bios.mbsn, sizeof(bios.mbsn)));
+        module.push_back(0);
+    }
+}
+
+image_status_t FD44Image::buildLayout(const ByteView & image, const bios_t & bios, patch_layout_t & layout)
+{
+    image_offsets_t offsets;
+    scan(image, offsets);
+    return buildLayout(image, offsets, bios, layout);
+}
+
+image_status_t FD44Image::buildLayout(const ByteView & image, const image_offsets_t & offsets, const bios_t & bios, patch_layout_t & layout)
+{
+    layout.modules.clear();
+    layout.module_lengths.clear();
+    layout.gbe_macs.clear();
+
+    // Checking for BOOTEFI header, the same one read() takes motherboard name from
+    int bootefi = SignatureScanner::lastHit(offsets.bootefi);
+    if (bootefi == -1)
+    {
+        return status(OutputBootefiNotFound, -1);
+    }
+
+    // Checking for module presence
+    int pos = SignatureScanner::firstHit(offsets.modules);
+    if (pos == -1)
+    {
+        return status(OutputModuleNotFound, -1);
+    }
+
+    // Checking motherboard name
+    int namePos = bootefi + BOOTEFI_HEADER.size() + BOOTEFI_MAGIC_LENGTH + BOOTEFI_BIOS_VERSION_LENGTH;
+    ByteView motherboardName = image.mid(namePos, BOOTEFI_MOTHERBOARD_NAME_LENGTH);
+    ByteView loadedName = field(bios, MotherboardNameField);
+    if ((int)strnlen(motherboardName.data(), motherboardName.size()) != loadedName.size()
+        || !motherboardName.matches(0, loadedName.data(), loadedName.size()))
+    {
+        return status(OutputMotherboardDiffers, namePos);
+    }
+
+    std::vector<uint8_t> module;
+    moduleData(bios, module);
+
+    // Finding all modules
+    ByteView moduleVersion;
+    int moduleLength;
+    pos = SignatureScanner::firstHit(offsets.modules);
+    while(pos != -1)
+    {
+        // Checking for BSA_ signature
+        if (!image.matches(pos + MODULE_HEADER_BSA_OFFSET, MODULE_HEADER_BSA))
+        {
+            pos = SignatureScanner::firstHit(offsets.modules, pos + MODULE_HEADER_LENGTH);
+            continue;
+        }
+        
+        // Reading module length
+        moduleLength = readModuleLength(image, pos);
+        if (moduleLength - MODULE_HEADER_LENGTH < (int)module.size())
+            return status(OutputModuleTooSmall, pos);
+
+        // Checking module version
+        moduleVersion = image.mid(pos + MODULE_VERSION_OFFSET, MODULE_VERSION_LENGTH);
+        if (moduleVersion.isEmpty() || moduleVersionIndex(moduleVersion.at(0)) < 0)
+        {
+            return status(OutputModuleVersionUnknown, pos + MODULE_VERSION_OFFSET);
+        }
+        if (!hasField(bios, ModuleVersionField) || !moduleVersion.matches(0, (const char*)bios.module_version, MODULE_VERSION_LENGTH))
+        {
+            return status(OutputModuleVersionDiffers, pos + MODULE_VERSION_OFFSET);
+        }
+
+        if (pos + moduleLength > image.size())
+            return status(OutputModuleTruncated, pos);
+
+        pos += MODULE_HEADER_LENGTH;
+        layout.modules.push_back(pos);
+        layout.module_lengths.push_back(moduleLength - MODULE_HEADER_LENGTH);
+        pos += moduleLength - MODULE_HEADER_LENGTH;
+
+        // Going to the next module
+        pos = SignatureScanner::firstHit(offsets.modules, pos);
+    }
+
+    // GbE MAC slots
+    if (bios.mac_type == GbE)
+    {
+        pos = SignatureScanner::firstHit(offsets.gbe);
+        int pos2 = SignatureScanner::lastHit(offsets.gbe);
+        if (pos == -1 || pos + GBE_MAC_OFFSET - MAC_LENGTH < 0)
+        {
+            return status(OutputGbeNotFound, -1);
+        }
+        layout.gbe_macs.push_back(pos + GBE_MAC_OFFSET - MAC_LENGTH);
+        if (pos2 != pos)
+            layout.gbe_macs.push_back(pos2 + GBE_MAC_OFFSET - MAC_LENGTH);
+    }
+
+    return status(NoError, -1);
+}
+
+image_status_t FD44Image::layoutPatches(const ByteView & image, const patch_layout_t & layout, const bios_t & bios, std::vector<image_patch_t> & patches)
+{
+    patches.clear();
+
+    std::vector<uint8_t> module;
+    moduleData(bios, module);
+
+    // Module data followed by FF bytes up to the end of the module
+    image_patch_t patch;
+    for (size_t i = 0; i < layout.modules.size(); i++)
+    {
+        if (layout.module_lengths[i] < (int)module.size())
+            return status(OutputModuleTooSmall, layout.modules[i] - MODULE_HEADER_LENGTH);
+
+        patch.offset = layout.modules[i];
+        patch.data = module;
+        patch.data.resize(layout.module_lengths[i], 0xFF);
+        addPatch(image, patch, patches);
+    }
+
+    // Both GbE MAC slots
+    patch.data.clear();
+    append(patch.data, field(bios, MacField));
+    for (size_t i = 0; i < layout.gbe_macs.size(); i++)
+    {
+        patch.offset = layout.gbe_macs[i];
+        addPatch(image, patch, patches);
+    }
+
+    return status(NoError, -1);
+}
+
+void FD44Image::addPatch(const ByteView & image, const image_patch_t & patch, std::vector<image_patch_t> & patches)
+{
+    // Ranges that already hold new bytes are not written
+    if (image.matches(patch.offset, (const char*)patch.data.data(), (int)patch.data.size()))
+        return;
+
+    patches.push_back(patch);
+}
+
+void FD44Image::applyPatches(char *image, int size, const std::vector<image_patch_t> & patches)
+{
+    for (size_t i = 0; i < patches.size(); i++)
+    {
+        const image_patch_t & patch = patches[i];
+        if (patch.offset < 0 || patch.offset + (int)patch.data.size() > size)
+            continue;
+        memcpy(image + patch.offset, patch.data.data(), patch.data.size());
+    }
+}
+
+bool FD44Image::hasField(const bios_t & bios, bios_field_e field)
+{
+    return (bios.fields >> field) & 1;
+}
+
+ByteView FD44Image::field(const bios_t & bios, bios_field_e field)
+{
+    if (!hasField(bios, field))
+        return ByteView();
+
+    const bios_field_t & location = BIOS_FIELDS[field];
+    const char *data = (const char*)&bios + location.offset;
+    return ByteView(data, location.text ? (int)strnlen(data, location.length) : location.length);
+}
+
+bool FD44Image::setField(bios_t & bios, bios_field_e field, const ByteView & value)
+{
+    return storeField(bios, field, value);
+}
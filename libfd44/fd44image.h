@@ -0,0 +1,111 @@
+/* fd44image.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef FD44IMAGE_H
+#define FD44IMAGE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "bios.h"
+#include "byteview.h"
+
+// Parsing and writing errors
+enum image_error_e {NoError, BootefiNotFound, ModuleNotFound, ModuleVersionUnknown, ModuleVersionUnsupported,
+                    ShortDtsPart2Unknown, LongDtsPart2Unknown, LongDtsPart3Unknown, LongDtsKeyCorrupted,
+                    LongDtsPart4Unknown, UuidNotFound, MbsnNotFound,
+                    OutputBootefiNotFound, OutputModuleNotFound, OutputMotherboardDiffers, OutputModuleTooSmall,
+                    OutputModuleVersionUnknown, OutputModuleVersionDiffers, OutputModuleTruncated, OutputGbeNotFound};
+
+// Result of parsing or writing, offset of failing structure is -1 if it was not found
+typedef struct {
+    image_error_e error;
+    int offset;
+} image_status_t;
+
+// Parsing stages timed by read() when profile is requested
+enum read_stage_e {ScanStage, BootefiStage, MeStage, GbeStage, ModuleStage, AsciiMacStage,
+                   ShortDtsStage, LongDtsStage, UuidStage, MbsnStage, ReadStageCount};
+
+// Time spent in each parsing stage, nanoseconds.
+// Stages after failing one are not reached and stay 0.
+typedef struct {
+    int64_t nsecs[ReadStageCount];
+} read_profile_t;
+
+// Replaced byte range of image
+typedef struct {
+    int offset;
+    std::vector<uint8_t> data;
+} image_patch_t;
+
+// Signature offsets found by image scan.
+// All images of one BIOS build have them at the same offsets,
+// so they can be found once per build and only checked in other images.
+typedef struct {
+    std::vector<int> bootefi;           // $BOOTEFI$ blocks
+    std::vector<int> me;                // ME partition table headers
+    std::vector<int> gbe;               // GbE region headers
+    std::vector<int> modules;           // FD44 module headers, from firmware volumes if found there
+} image_offsets_t;
+
+// Image ranges written by buildPatches, all images built from one
+// BIOS release share them, so they are found once per release
+typedef struct {
+    std::vector<int> modules;           // FD44 module body offsets
+    std::vector<int> module_lengths;    // module body lengths including FF tail
+    std::vector<int> gbe_macs;          // GbE MAC slot offsets
+} patch_layout_t;
+
+// FD44 module parser and writer.
+// Depends on C++ standard library only, image is passed as non-owning view,
+// so it can be embedded without Qt.
+class FD44Image
+{
+public:
+    // Parses image, bios.state is ParseError if status is not NoError.
+    // Stage timings are collected only if profile is given.
+    static image_status_t read(const ByteView & image, bios_t & bios, read_profile_t *profile = 0);
+
+    // Scanning is split from read() and buildLayout(), so offsets found in one image
+    // can be used for other images of the same build after checkOffsets() succeeds
+    static void scan(const ByteView & image, image_offsets_t & offsets);
+    static bool checkOffsets(const ByteView & image, const image_offsets_t & offsets);
+    static image_status_t read(const ByteView & image, const image_offsets_t & offsets, bios_t & bios, read_profile_t *profile = 0);
+
+    // Computes byte ranges to be replaced in image to write bios:
+    // body of every FD44 module with its FF tail and both GbE MAC slots.
+    // Ranges that already hold new bytes are omitted.
+    static image_status_t buildPatches(const ByteView & image, const bios_t & bios, std::vector<image_patch_t> & patches);
+    static void applyPatches(char *image, int size, const std::vector<image_patch_t> & patches);
+
+    // Split buildPatches: layout search is done once for image and bios field types,
+    // then patches for any bios with the same types are computed without searching image
+    static image_status_t buildLayout(const ByteView & image, const bios_t & bios, patch_layout_t & layout);
+    static image_status_t buildLayout(const ByteView & image, const image_offsets_t & offsets, const bios_t & bios, patch_layout_t & layout);
+    static image_status_t layoutPatches(const ByteView & image, const patch_layout_t & layout, const bios_t & bios, std::vector<image_patch_t> & patches);
+
+    // Returns size of AMI Aptio capsule header, 0 if there is none
+    static int capsuleOffset(const ByteView & image);
+
+    // Fixed-size bios_t fields, empty view is returned for missing field.
+    // Setting empty view removes field, text fields are returned up to terminating zero.
+    static bool hasField(const bios_t & bios, bios_field_e field);
+    static ByteView field(const bios_t & bios, bios_field_e field);
+    static bool setField(bios_t & bios, bios_field_e field, const ByteView & value);
+
+private:
+    static void addPatch(const ByteView & image, const image_patch_t & patch, std::vector<image_patch_t> & patches);
+};
+
+#endif // FD44IMAGE_H
@@ -0,0 +1,36 @@
+# FD44 module parsing library, C++ standard library only
+# Signature search uses SSE2 on x86, add QMAKE_CXXFLAGS += -mavx2 to use AVX2
+
+# Board and signature tables are built at compile time
+CONFIG += c++14
+lessThan(QT_MAJOR_VERSION, 5): QMAKE_CXXFLAGS += -std=c++14
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += $$PWD/bloomfilter.cpp \
+    $$PWD/delta.cpp \
+    $$PWD/descriptor.cpp \
+    $$PWD/dupindex.cpp \
+    $$PWD/fd44image.cpp \
+    $$PWD/mefpt.cpp \
+    $$PWD/parsecache.cpp \
+    $$PWD/scanner.cpp \
+    $$PWD/sha256.cpp \
+    $$PWD/volume.cpp \
+    $$PWD/xxhash.cpp
+
+HEADERS += $$PWD/bloomfilter.h \
+    $$PWD/delta.h \
+    $$PWD/descriptor.h \
+    $$PWD/dupindex.h \
+    $$PWD/fd44image.h \
+    $$PWD/mefpt.h \
+    $$PWD/parsecache.h \
+    $$PWD/scanner.h \
+    $$PWD/sha256.h \
+    $$PWD/bios.h \
+    $$PWD/byteview.h \
+    $$PWD/motherboards.h \
+    $$PWD/volume.h \
+    $$PWD/xxhash.h
@@ -0,0 +1,8 @@
+# Static library for embedding FD44 parser into other applications, does not use Qt
+
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+TARGET = fd44
+
+include(libfd44.pri)
@@ -0,0 +1,66 @@
+/* mefpt.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "mefpt.h"
+
+static uint32_t readUint32(const ByteView & image, int pos)
+{
+    return (uint32_t)image.at(pos) | (uint32_t)image.at(pos + 1) << 8 |
+           (uint32_t)image.at(pos + 2) << 16 | (uint32_t)image.at(pos + 3) << 24;
+}
+
+bool MePartitionTable::read(const ByteView & image, int offset, int regionStart, int regionEnd, me_firmware_t & me)
+{
+    me.type = ME_15M;
+    me.version = -1;
+
+    int region = regionStart;
+    if (region < 0 || offset < region || regionEnd > image.size() || offset + ME_FPT_MIN_HEADER_LENGTH > regionEnd)
+        return false;
+
+    uint32_t count = readUint32(image, offset + ME_FPT_COUNT_OFFSET);
+    int headerLength = image.at(offset + ME_FPT_HEADER_LENGTH_OFFSET);
+    if (count == 0 || count > ME_FPT_MAX_ENTRIES || headerLength < ME_FPT_MIN_HEADER_LENGTH
+        || offset + headerLength + (int)count * ME_FPT_ENTRY_LENGTH > regionEnd)
+        return false;
+
+    bool has3m = false, has5m = false;
+    for (int i = 0; i < (int)count; i++)
+    {
+        int entry = offset + headerLength + i * ME_FPT_ENTRY_LENGTH;
+
+        // Additional partitions are present in larger firmware
+        if (image.matches(entry, ME_5M_SIGN))
+            has5m = true;
+        else if (image.matches(entry, ME_3M_SIGN))
+            has3m = true;
+        else if (image.matches(entry, ME_FTPR_NAME))
+        {
+            uint32_t start = readUint32(image, entry + ME_FPT_ENTRY_OFFSET_OFFSET);
+            uint32_t length = readUint32(image, entry + ME_FPT_ENTRY_LENGTH_OFFSET);
+            if (start > (uint32_t)(regionEnd - region) || length > (uint32_t)(regionEnd - region) - start)
+                return false;
+
+            int manifest = region + (int)start + ME_MANIFEST_SIGNATURE_OFFSET;
+            if (length >= ME_MANIFEST_SIGNATURE_OFFSET + ME_VERSION_HEADER.size() + ME_VERSION_OFFSET + ME_VERSION_LENGTH
+                && image.matches(manifest, ME_VERSION_HEADER))
+                me.version = manifest + ME_VERSION_HEADER.size() + ME_VERSION_OFFSET;
+        }
+    }
+
+    if (has5m)
+        me.type = ME_5M;
+    else if (has3m)
+        me.type = ME_3M;
+    return true;
+}
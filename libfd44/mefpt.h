@@ -0,0 +1,57 @@
+/* mefpt.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef MEFPT_H
+#define MEFPT_H
+
+#include <stdint.h>
+
+#include "bios.h"
+#include "byteview.h"
+
+// ME region starts with ROM bypass vector followed by $FPT partition table
+#define ME_FPT_ROMB_LENGTH                  0x10
+#define ME_FPT_SIGNATURE_LENGTH             4
+#define ME_FPT_COUNT_OFFSET                 4
+#define ME_FPT_HEADER_LENGTH_OFFSET         10
+#define ME_FPT_MIN_HEADER_LENGTH            0x20
+#define ME_FPT_MAX_ENTRIES                  64
+
+// Partition entry: name, owner, offset and length relative to ME region start
+#define ME_FPT_ENTRY_LENGTH                 0x20
+#define ME_FPT_ENTRY_OFFSET_OFFSET          8
+#define ME_FPT_ENTRY_LENGTH_OFFSET          12
+constexpr auto ME_FTPR_NAME               = signature("FTPR");
+
+// Code partition manifest
+#define ME_MANIFEST_SIGNATURE_OFFSET        0x1C
+
+// ME firmware described by partition table
+typedef struct {
+    int type;           // me_e
+    int version;        // offset of version after $MN2 of FTPR manifest, -1 if not found
+} me_firmware_t;
+
+// $FPT partition table parser.
+// Firmware type is given by partition entries, version by FTPR manifest,
+// so nothing outside of the table and that manifest is read.
+class MePartitionTable
+{
+public:
+    // Reads table with $FPT signature at offset inside ME region [regionStart, regionEnd),
+    // partition offsets are relative to regionStart and all partitions must end before regionEnd.
+    // Returns false if table is malformed or lies outside of the region.
+    static bool read(const ByteView & image, int offset, int regionStart, int regionEnd, me_firmware_t & me);
+};
+
+#endif // MEFPT_H
@@ -16,452 +16,472 @@
 
 #include "bios.h"
 
+// Optional magic bytes of board table entry
+template <size_t N> struct board_magic_t {
+    bool present;
+    std::array<uint8_t, N> bytes;
+};
+
+constexpr board_magic_t<ASCII_MAC_MAGIC_LENGTH> NO_MAC_MAGIC = {false, {{0}}};
+constexpr board_magic_t<DTS_LONG_MAGIC_LENGTH> NO_DTS_MAGIC = {false, {{0}}};
+
+constexpr board_magic_t<ASCII_MAC_MAGIC_LENGTH> macMagic(uint8_t magic)
+{
+    return {true, {{magic}}};
+}
+
+constexpr board_magic_t<DTS_LONG_MAGIC_LENGTH> dtsMagic(const dts_magic_t & magic)
+{
+    return {true, magic};
+}
+
+// Board table is constant-initialized, so it costs nothing at startup
 typedef struct {
     char name[BOOTEFI_MOTHERBOARD_NAME_LENGTH];
     mac_e mac_type;
-    QByteArray mac_magic;
+    board_magic_t<ASCII_MAC_MAGIC_LENGTH> mac_magic;
     dts_e dts_type;
-    QByteArray dts_magic;
+    board_magic_t<DTS_LONG_MAGIC_LENGTH> dts_magic;
 } motherboard_t;
 
-const motherboard_t SUPPORTED_MOTHERBOARDS_LIST[] = 
+constexpr motherboard_t SUPPORTED_MOTHERBOARDS_LIST[] = 
 {
     // H61
     {
         "P8H61-MX-R2",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H61-M", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H61-M-EVO",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H61-M-LE", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H61-M-LE-R2", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H61-M-LX", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     }, {
         "P8H61-M-PRO",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // H67
     {
         "P8H67",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H67-I",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H67-V",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // P67
     {
         "MaximusIV-Extreme",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67", 
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-REV31", 
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-DELUXE", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },{
         "P8P67-EVO",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-LE", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-PRO", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-PRO-REV31", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-WS-REVOLUTION", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V3,
+        dtsMagic(DTS_LONG_MAGIC_V3),
     },{
         "P8P67-M", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8P67-M-PRO", 
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V2,
+        dtsMagic(DTS_LONG_MAGIC_V2),
     },{
         "SABERTOOTH-P67", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
     
     // Z68
     {
         "Maximus-IV-Extreme-Z",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "MaximusIV-GENE-Z", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "MAXIMUS-IV-GENE-Z-GEN3",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-DELUXE", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },{
         "P8Z68-DELUXE-GEN3",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },{
         "P8Z68-V", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-V-GEN3",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-V-LE",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-V-LX",
         ASCII,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-V-PRO", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z68-V-PRO-GEN3",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Short,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // B75
     {
         "P8B75-M", 
         ASCII,
-        QByteArray("\x26", 1),
+        macMagic(0x26),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8B75-M-LE", 
         ASCII,
-        QByteArray("\x25", 1),
+        macMagic(0x25),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8B75-M-LX", 
         ASCII,
-        QByteArray("\x24", 1),
+        macMagic(0x24),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8B75-M-LX-PLUS", 
         ASCII,
-        QByteArray("\x22", 1),
+        macMagic(0x22),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // H77
     {
         "P8H77-I",
         ASCII,
-        QByteArray("\x22", 1),
+        macMagic(0x22),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H77-V",
         ASCII,
-        QByteArray("\x2A", 1),
+        macMagic(0x2A),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H77-V-LE",
         ASCII,
-        QByteArray("\x26", 1),
+        macMagic(0x26),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H77-M",
         ASCII,
-        QByteArray("\x25", 1),
+        macMagic(0x25),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8H77-M-PRO",
         ASCII,
-        QByteArray("\x28", 1),
+        macMagic(0x28),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // Z77
     {
         "MAXIMUS-V-FORMULA", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "MAXIMUS-V-EXTREME", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "MAXIMUS-V-GENE", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-I-DELUXE", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-M", 
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-M-PRO", 
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V-DELUXE", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V-LE", 
         ASCII,
-        QByteArray("\x2D", 1),
+        macMagic(0x2D),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V-LE-PLUS", 
         ASCII,
-        QByteArray("\x2D", 1),
+        macMagic(0x2D),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V-LX", 
         ASCII,
-        QByteArray("\x2D", 1),
+        macMagic(0x2D),
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-V-PRO", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8Z77-WS", 
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },{
         "SABERTOOTH-Z77", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     // X79
     {
         "P9X79", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },{
         "Rampage-IV-Extreme", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "SABERTOOTH-X79", 
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         Long,
-        DTS_LONG_MAGIC_V1,
+        dtsMagic(DTS_LONG_MAGIC_V1),
     },
 
 	//C204
     {
         "P8B-M",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "P8B-E-4L",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     //C602
     {
         "Z9PE-D16",
         UUID,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 
     //Z87
     {
         "MAXIMUS-VI-EXTREME",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "MAXIMUS-VI-HERO",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "SABERTOOTH-Z87",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "Z87-DELUXE",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },{
         "Z87-EXPERT",
         GbE,
-        QByteArray(),
+        NO_MAC_MAGIC,
         None,
-        QByteArray(),
+        NO_DTS_MAGIC,
     },
 };
 
-const unsigned int SUPPORTED_MOTHERBOARDS_LIST_LENGTH = sizeof(SUPPORTED_MOTHERBOARDS_LIST) / sizeof(SUPPORTED_MOTHERBOARDS_LIST[0]);
+constexpr unsigned int SUPPORTED_MOTHERBOARDS_LIST_LENGTH = sizeof(SUPPORTED_MOTHERBOARDS_LIST) / sizeof(SUPPORTED_MOTHERBOARDS_LIST[0]);
 
 #endif // MOTHERBOARDS_H
@@ -0,0 +1,272 @@
+/* parsecache.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <string.h>
+#include <unordered_set>
+
+#include "parsecache.h"
+#include "xxhash.h"
+
+static void appendUint(std::vector<uint8_t> & data, uint64_t value, int length)
+{
+    for (int i = 0; i < length; i++)
+        data.push_back((uint8_t)(value >> (i * 8)));
+}
+
+static uint64_t readUint(const ByteView & data, int pos, int length)
+{
+    uint64_t value = 0;
+    for (int i = length - 1; i >= 0; i--)
+        value = value << 8 | data.at(pos + i);
+    return value;
+}
+
+static void appendOffsets(std::vector<uint8_t> & data, const std::vector<int> & offsets)
+{
+    appendUint(data, offsets.size(), 4);
+    for (size_t i = 0; i < offsets.size(); i++)
+        appendUint(data, (uint32_t)offsets[i], 4);
+}
+
+// Reads offset list, all offsets must be inside of image
+static bool readOffsets(const ByteView & data, int & pos, int imageSize, std::vector<int> & offsets)
+{
+    if (data.size() - pos < 4)
+        return false;
+    uint32_t count = (uint32_t)readUint(data, pos, 4);
+    pos += 4;
+    if (count > (uint32_t)(data.size() - pos) / 4)
+        return false;
+
+    offsets.resize(count);
+    for (uint32_t i = 0; i < count; i++, pos += 4)
+    {
+        uint32_t offset = (uint32_t)readUint(data, pos, 4);
+        if (offset >= (uint32_t)imageSize)
+            return false;
+        offsets[i] = (int)offset;
+    }
+    return true;
+}
+
+// Key of build whose last $BOOTEFI$ block is at given offset
+static bool matchesKey(const ByteView & image, int bootefi, const uint8_t key[BUILD_KEY_LENGTH])
+{
+    return image.matches(bootefi, BOOTEFI_HEADER)
+        && image.matches(bootefi + BUILD_KEY_OFFSET, (const char*)key, BUILD_KEY_LENGTH);
+}
+
+uint64_t ParseCache::hash(const ByteView & image)
+{
+    return XxHash64::hash(image.data(), image.size());
+}
+
+bool ParseCache::findFile(const std::string & path, int64_t size, int64_t mtime, uint64_t & hash) const
+{
+    std::unordered_map<std::string, file_state_t>::const_iterator it = files.find(path);
+    if (it == files.end() || it->second.size != size || it->second.mtime != mtime)
+        return false;
+    hash = it->second.hash;
+    return true;
+}
+
+bool ParseCache::findResult(uint64_t hash, parse_result_t & result) const
+{
+    std::unordered_map<uint64_t, parse_result_t>::const_iterator it = results.find(hash);
+    if (it == results.end())
+        return false;
+    result = it->second;
+    return true;
+}
+
+void ParseCache::addFile(const std::string & path, const file_state_t & state)
+{
+    files[path] = state;
+}
+
+void ParseCache::addResult(uint64_t hash, const parse_result_t & result)
+{
+    results[hash] = result;
+}
+
+bool ParseCache::findBuild(const ByteView & image, image_offsets_t & offsets) const
+{
+    // Builds are few, so key bytes are compared at offset of each one
+    for (size_t i = 0; i < builds.size(); i++)
+    {
+        const build_offsets_t & build = builds[i];
+        if (build.image_size == image.size() && matchesKey(image, build.offsets.bootefi.back(), build.key)
+            && FD44Image::checkOffsets(image, build.offsets))
+        {
+            offsets = build.offsets;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParseCache::addBuild(const ByteView & image, const image_offsets_t & offsets)
+{
+    if (offsets.bootefi.empty())
+        return;
+
+    build_offsets_t build;
+    build.image_size = image.size();
+    ByteView key = image.mid(offsets.bootefi.back() + BUILD_KEY_OFFSET, BUILD_KEY_LENGTH);
+    if (key.size() != BUILD_KEY_LENGTH)
+        return;
+    memcpy(build.key, key.data(), BUILD_KEY_LENGTH);
+    build.offsets = offsets;
+
+    // Offsets of the same build found in another image replace old ones
+    for (size_t i = 0; i < builds.size(); i++)
+    {
+        if (builds[i].image_size == build.image_size && !memcmp(builds[i].key, build.key, BUILD_KEY_LENGTH))
+        {
+            builds[i] = build;
+            return;
+        }
+    }
+    builds.push_back(build);
+}
+
+void ParseCache::write(std::vector<uint8_t> & data) const
+{
+    data.assign(PARSE_CACHE_SIGNATURE.begin(), PARSE_CACHE_SIGNATURE.end());
+    appendUint(data, sizeof(bios_t), 4);
+
+    std::unordered_set<uint64_t> hashes;
+    appendUint(data, files.size(), 4);
+    for (std::unordered_map<std::string, file_state_t>::const_iterator it = files.begin(); it != files.end(); ++it)
+    {
+        appendUint(data, it->first.size(), 4);
+        data.insert(data.end(), it->first.begin(), it->first.end());
+        appendUint(data, (uint64_t)it->second.size, 8);
+        appendUint(data, (uint64_t)it->second.mtime, 8);
+        appendUint(data, it->second.hash, 8);
+        hashes.insert(it->second.hash);
+    }
+
+    int count = 0;
+    size_t countPos = data.size();
+    appendUint(data, 0, 4);
+    for (std::unordered_map<uint64_t, parse_result_t>::const_iterator it = results.begin(); it != results.end(); ++it)
+    {
+        if (!hashes.count(it->first))
+            continue;
+        appendUint(data, it->first, 8);
+        appendUint(data, (uint32_t)it->second.status.error, 4);
+        appendUint(data, (uint32_t)it->second.status.offset, 4);
+        const uint8_t *bios = (const uint8_t*)&it->second.bios;
+        data.insert(data.end(), bios, bios + sizeof(bios_t));
+        count++;
+    }
+    for (int i = 0; i < 4; i++)
+        data[countPos + i] = (uint8_t)(count >> (i * 8));
+
+    appendUint(data, builds.size(), 4);
+    for (size_t i = 0; i < builds.size(); i++)
+    {
+        const build_offsets_t & build = builds[i];
+        appendUint(data, (uint32_t)build.image_size, 4);
+        data.insert(data.end(), build.key, build.key + BUILD_KEY_LENGTH);
+        appendOffsets(data, build.offsets.bootefi);
+        appendOffsets(data, build.offsets.me);
+        appendOffsets(data, build.offsets.gbe);
+        appendOffsets(data, build.offsets.modules);
+    }
+}
+
+bool ParseCache::read(const ByteView & data)
+{
+    files.clear();
+    results.clear();
+    builds.clear();
+    if (data.size() < PARSE_CACHE_HEADER_LENGTH || !data.matches(0, PARSE_CACHE_SIGNATURE)
+        || readUint(data, PARSE_CACHE_SIGNATURE.size(), 4) != sizeof(bios_t))
+        return false;
+
+    // Tables are filled only when the whole cache is read
+    std::unordered_map<std::string, file_state_t> newFiles;
+    std::unordered_map<uint64_t, parse_result_t> newResults;
+    int pos = PARSE_CACHE_SIGNATURE.size() + 4;
+    uint32_t count = (uint32_t)readUint(data, pos, 4);
+    pos += 4;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (data.size() - pos < PARSE_CACHE_FILE_LENGTH)
+            return false;
+        uint32_t length = (uint32_t)readUint(data, pos, 4);
+        if (length > (uint32_t)(data.size() - pos - PARSE_CACHE_FILE_LENGTH))
+            return false;
+        pos += 4;
+        std::string path(data.data() + pos, length);
+        pos += (int)length;
+
+        file_state_t state;
+        state.size = (int64_t)readUint(data, pos, 8);
+        state.mtime = (int64_t)readUint(data, pos + 8, 8);
+        state.hash = readUint(data, pos + 16, 8);
+        pos += 24;
+        newFiles[path] = state;
+    }
+
+    if (data.size() - pos < 4)
+        return false;
+    count = (uint32_t)readUint(data, pos, 4);
+    pos += 4;
+    if (count > (data.size() - pos) / PARSE_CACHE_RESULT_LENGTH)
+        return false;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        parse_result_t result;
+        uint64_t hash = readUint(data, pos, 8);
+        result.status.error = (image_error_e)readUint(data, pos + 8, 4);
+        result.status.offset = (int)readUint(data, pos + 12, 4);
+        memcpy(&result.bios, data.data() + pos + 16, sizeof(bios_t));
+        pos += PARSE_CACHE_RESULT_LENGTH;
+        newResults[hash] = result;
+    }
+
+    // Every build has at least one $BOOTEFI$ offset, its key is read from the last one
+    std::vector<build_offsets_t> newBuilds;
+    if (data.size() - pos < 4)
+        return false;
+    count = (uint32_t)readUint(data, pos, 4);
+    pos += 4;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        build_offsets_t build;
+        if (data.size() - pos < 4 + BUILD_KEY_LENGTH)
+            return false;
+        uint32_t imageSize = (uint32_t)readUint(data, pos, 4);
+        if (imageSize > 0x7FFFFFFF)
+            return false;
+        build.image_size = (int)imageSize;
+        memcpy(build.key, data.data() + pos + 4, BUILD_KEY_LENGTH);
+        pos += 4 + BUILD_KEY_LENGTH;
+        if (!readOffsets(data, pos, build.image_size, build.offsets.bootefi) || build.offsets.bootefi.empty()
+            || !readOffsets(data, pos, build.image_size, build.offsets.me)
+            || !readOffsets(data, pos, build.image_size, build.offsets.gbe)
+            || !readOffsets(data, pos, build.image_size, build.offsets.modules))
+            return false;
+        newBuilds.push_back(build);
+    }
+    if (pos != data.size())
+        return false;
+
+    files.swap(newFiles);
+    results.swap(newResults);
+    builds.swap(newBuilds);
+    return true;
+}
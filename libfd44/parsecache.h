@@ -0,0 +1,99 @@
+/* parsecache.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bios.h"
+#include "byteview.h"
+#include "fd44image.h"
+
+// Parse cache file, all numbers are little-endian:
+// signature, bios_t record size, file count, then every file as path length,
+// UTF-8 path, size, modification time and content hash, result count,
+// then every result as content hash, status error and offset and bios_t record as is,
+// build count, then every build as image size, build key and four offset lists,
+// each as offset count and offsets, in image_offsets_t order.
+// Signature is changed when parser results for the same image change.
+constexpr auto PARSE_CACHE_SIGNATURE      = signature("FD44PCH2");
+#define PARSE_CACHE_HEADER_LENGTH           (8 + 4 + 4)
+#define PARSE_CACHE_FILE_LENGTH             (4 + 8 + 8 + 8)
+#define PARSE_CACHE_RESULT_LENGTH           (8 + 4 + 4 + sizeof(bios_t))
+
+// Build key is BIOS version, board name and BIOS date part of last $BOOTEFI$ block
+#define BUILD_KEY_OFFSET                    (BOOTEFI_HEADER.size() + BOOTEFI_MAGIC_LENGTH)
+#define BUILD_KEY_LENGTH                    (BOOTEFI_BIOS_VERSION_LENGTH + BOOTEFI_MOTHERBOARD_NAME_LENGTH \
+                                             + BOOTEFI_BIOS_DATE_OFFSET + BOOTEFI_BIOS_DATE_LENGTH)
+
+// Result of FD44Image::read
+typedef struct {
+    bios_t bios;
+    image_status_t status;
+} parse_result_t;
+
+// File state when it was parsed, size and modification time
+// are compared before content is read
+typedef struct {
+    int64_t size;
+    int64_t mtime;
+    uint64_t hash;      // XXH64 of image content
+} file_state_t;
+
+// Signature offsets shared by all images of one BIOS build
+typedef struct {
+    int image_size;
+    uint8_t key[BUILD_KEY_LENGTH];
+    image_offsets_t offsets;
+} build_offsets_t;
+
+// Parse results by image content hash and content hashes by file path.
+// Unchanged file is found by path without reading it, renamed or copied
+// image is found by its content without parsing it, and new image of known
+// BIOS build is parsed with signature offsets of that build without scanning it.
+class ParseCache
+{
+public:
+    static uint64_t hash(const ByteView & image);
+
+    // Content hash of file seen with the same size and modification time
+    bool findFile(const std::string & path, int64_t size, int64_t mtime, uint64_t & hash) const;
+    bool findResult(uint64_t hash, parse_result_t & result) const;
+
+    void addFile(const std::string & path, const file_state_t & state);
+    void addResult(uint64_t hash, const parse_result_t & result);
+
+    // Offsets of image build, found by build key at $BOOTEFI$ offset of every known build
+    // of the same image size. False is returned if there is no such build or if any
+    // of its signatures is not found in image at the same offset.
+    bool findBuild(const ByteView & image, image_offsets_t & offsets) const;
+    // Image must be parsed without errors with these offsets
+    void addBuild(const ByteView & image, const image_offsets_t & offsets);
+
+    // Results not referenced by any file are not written
+    void write(std::vector<uint8_t> & data) const;
+    // Returns false and leaves cache empty if data is not a complete cache
+    // written by the same build
+    bool read(const ByteView & data);
+
+private:
+    std::unordered_map<std::string, file_state_t> files;
+    std::unordered_map<uint64_t, parse_result_t> results;
+    std::vector<build_offsets_t> builds;
+};
+
+#endif // PARSECACHE_H
@@ -0,0 +1,296 @@
+/* scanner.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <queue>
+
+#include "scanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCANNER_AVX2
+#define SCANNER_ENGINE_NAME "AVX2"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCANNER_SSE2
+#define SCANNER_ENGINE_NAME "SSE2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCANNER_NEON
+#define SCANNER_ENGINE_NAME "NEON"
+#else
+#define SCANNER_ENGINE_NAME "automaton"
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Signatures compared per SIMD block, automaton is used for larger sets
+#define SCANNER_MAX_SIMD_SIGNATURES 16
+
+static inline int lowestBit(unsigned long long mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+SignatureScanner::SignatureScanner()
+    : minLength(0), maxLength(0)
+{
+    // Root state
+    trie.assign(ALPHABET_SIZE, -1);
+    outputs.resize(1);
+}
+
+int SignatureScanner::addSignature(const char *signature, int length)
+{
+    int state = 0;
+    for (int i = 0; i < length; i++)
+    {
+        int index = state * ALPHABET_SIZE + (unsigned char)signature[i];
+        if (trie[index] == -1)
+        {
+            trie[index] = (int)outputs.size();
+            trie.resize(trie.size() + ALPHABET_SIZE, -1);
+            outputs.resize(outputs.size() + 1);
+        }
+        state = trie[index];
+    }
+
+    int id = (int)signatures.size();
+    signatures.push_back(std::vector<unsigned char>(signature, signature + length));
+    outputs[state].push_back(id);
+
+    if (id == 0 || length < minLength)
+        minLength = length;
+    if (length > maxLength)
+        maxLength = length;
+
+    return id;
+}
+
+void SignatureScanner::build()
+{
+    int states = (int)outputs.size();
+    std::vector<int> fail(states, 0);
+    delta.assign(trie.size(), 0);
+
+    // Breadth-first walk, failure state of every state is processed before it
+    std::queue<int> queue;
+    for (int c = 0; c < ALPHABET_SIZE; c++)
+    {
+        int next = trie[c];
+        if (next != -1)
+        {
+            delta[c] = next;
+            queue.push(next);
+        }
+    }
+
+    while (!queue.empty())
+    {
+        int state = queue.front();
+        queue.pop();
+
+        const std::vector<int> & inherited = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+
+        for (int c = 0; c < ALPHABET_SIZE; c++)
+        {
+            int index = state * ALPHABET_SIZE + c;
+            int next = trie[index];
+            if (next != -1)
+            {
+                fail[next] = delta[fail[state] * ALPHABET_SIZE + c];
+                delta[index] = next;
+                queue.push(next);
+            }
+            else
+                delta[index] = delta[fail[state] * ALPHABET_SIZE + c];
+        }
+    }
+
+    terminal.assign(states, 0);
+    for (int i = 0; i < states; i++)
+        terminal[i] = !outputs[i].empty();
+}
+
+const char* SignatureScanner::defaultEngineName()
+{
+    return SCANNER_ENGINE_NAME;
+}
+
+void SignatureScanner::scan(const char *data, size_t size, std::vector<hits_t> & hits, engine_e engine) const
+{
+    hits.assign(signatures.size(), hits_t());
+    if (signatures.empty())
+        return;
+
+    const unsigned char *bytes = (const unsigned char*)data;
+#if defined(SCANNER_AVX2) || defined(SCANNER_SSE2) || defined(SCANNER_NEON)
+    if (engine == DefaultEngine && signatures.size() <= SCANNER_MAX_SIMD_SIGNATURES)
+    {
+        scanCandidates(bytes, size, hits);
+        return;
+    }
+#else
+    (void)engine;
+#endif
+    scanAutomaton(bytes, size, hits);
+}
+
+void SignatureScanner::scanAutomaton(const unsigned char *data, size_t size, std::vector<hits_t> & hits) const
+{
+    const int *transitions = &delta[0];
+    int state = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        state = transitions[state * ALPHABET_SIZE + data[i]];
+        if (terminal[state])
+        {
+            const std::vector<int> & found = outputs[state];
+            for (size_t j = 0; j < found.size(); j++)
+                hits[found[j]].push_back((int)(i + 1 - signatures[found[j]].size()));
+        }
+    }
+}
+
+void SignatureScanner::verify(const unsigned char *data, size_t size, size_t pos, std::vector<hits_t> & hits) const
+{
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        const std::vector<unsigned char> & signature = signatures[i];
+        size_t length = signature.size();
+        if (pos + length <= size
+            && data[pos] == signature[0]
+            && data[pos + length - 1] == signature[length - 1]
+            && !memcmp(data + pos, &signature[0], length))
+            hits[i].push_back((int)pos);
+    }
+}
+
+void SignatureScanner::scanCandidates(const unsigned char *data, size_t size, std::vector<hits_t> & hits) const
+{
+    size_t count = signatures.size();
+    size_t lastOffset[SCANNER_MAX_SIMD_SIGNATURES];
+    for (size_t i = 0; i < count; i++)
+        lastOffset[i] = signatures[i].size() - 1;
+
+    // Every block position is a candidate if it holds first byte of some signature
+    // and the last byte of the same signature is found at its offset
+    size_t pos = 0;
+#if defined(SCANNER_AVX2)
+    const size_t blockSize = 32;
+    __m256i first[SCANNER_MAX_SIMD_SIGNATURES], last[SCANNER_MAX_SIMD_SIGNATURES];
+    for (size_t i = 0; i < count; i++)
+    {
+        first[i] = _mm256_set1_epi8((char)signatures[i].front());
+        last[i] = _mm256_set1_epi8((char)signatures[i].back());
+    }
+
+    for (; pos + blockSize + maxLength - 1 <= size; pos += blockSize)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(data + pos));
+        __m256i found = _mm256_setzero_si256();
+        for (size_t i = 0; i < count; i++)
+        {
+            __m256i tail = _mm256_loadu_si256((const __m256i*)(data + pos + lastOffset[i]));
+            found = _mm256_or_si256(found, _mm256_and_si256(_mm256_cmpeq_epi8(block, first[i]), _mm256_cmpeq_epi8(tail, last[i])));
+        }
+
+        unsigned long long mask = (unsigned int)_mm256_movemask_epi8(found);
+        while (mask)
+        {
+            verify(data, size, pos + lowestBit(mask), hits);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(SCANNER_SSE2)
+    const size_t blockSize = 16;
+    __m128i first[SCANNER_MAX_SIMD_SIGNATURES], last[SCANNER_MAX_SIMD_SIGNATURES];
+    for (size_t i = 0; i < count; i++)
+    {
+        first[i] = _mm_set1_epi8((char)signatures[i].front());
+        last[i] = _mm_set1_epi8((char)signatures[i].back());
+    }
+
+    for (; pos + blockSize + maxLength - 1 <= size; pos += blockSize)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(data + pos));
+        __m128i found = _mm_setzero_si128();
+        for (size_t i = 0; i < count; i++)
+        {
+            __m128i tail = _mm_loadu_si128((const __m128i*)(data + pos + lastOffset[i]));
+            found = _mm_or_si128(found, _mm_and_si128(_mm_cmpeq_epi8(block, first[i]), _mm_cmpeq_epi8(tail, last[i])));
+        }
+
+        unsigned long long mask = (unsigned int)_mm_movemask_epi8(found);
+        while (mask)
+        {
+            verify(data, size, pos + lowestBit(mask), hits);
+            mask &= mask - 1;
+        }
+    }
+#elif defined(SCANNER_NEON)
+    const size_t blockSize = 16;
+    uint8x16_t first[SCANNER_MAX_SIMD_SIGNATURES], last[SCANNER_MAX_SIMD_SIGNATURES];
+    for (size_t i = 0; i < count; i++)
+    {
+        first[i] = vdupq_n_u8(signatures[i].front());
+        last[i] = vdupq_n_u8(signatures[i].back());
+    }
+
+    for (; pos + blockSize + maxLength - 1 <= size; pos += blockSize)
+    {
+        uint8x16_t block = vld1q_u8(data + pos);
+        uint8x16_t found = vdupq_n_u8(0);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8x16_t tail = vld1q_u8(data + pos + lastOffset[i]);
+            found = vorrq_u8(found, vandq_u8(vceqq_u8(block, first[i]), vceqq_u8(tail, last[i])));
+        }
+
+        // NEON has no movemask, every byte is narrowed to 4 bits instead
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(found), 4);
+        unsigned long long mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+        while (mask)
+        {
+            int bit = lowestBit(mask);
+            verify(data, size, pos + bit / 4, hits);
+            mask &= ~(0xFULL << bit);
+        }
+    }
+#endif
+
+    // Positions near the end of data
+    for (; pos + minLength <= size; pos++)
+        verify(data, size, pos, hits);
+}
+
+int SignatureScanner::firstHit(const hits_t & hits, int from)
+{
+    hits_t::const_iterator it = std::lower_bound(hits.begin(), hits.end(), from);
+    return it == hits.end() ? -1 : *it;
+}
+
+int SignatureScanner::lastHit(const hits_t & hits)
+{
+    return hits.empty() ? -1 : hits.back();
+}
@@ -0,0 +1,78 @@
+/* scanner.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+// Sorted offsets of all occurrences of one signature
+typedef std::vector<int> hits_t;
+
+// Multi-signature scanner, finds all occurrences of all added signatures
+// in single pass over data.
+// Candidate positions are found by comparing first and last byte of every
+// signature with SSE2, AVX2 or NEON, depending on target, and then verified.
+// Aho-Corasick automaton is used on targets without SIMD support.
+class SignatureScanner
+{
+public:
+    enum engine_e {DefaultEngine, AutomatonEngine};
+
+    SignatureScanner();
+
+    // Adds signature and returns its index in scan results
+    int addSignature(const char *signature, int length);
+    template <size_t N> int addSignature(const std::array<uint8_t, N> & signature)
+    {
+        return addSignature((const char*)signature.data(), N);
+    }
+
+    // Builds automaton, must be called after all signatures are added.
+    // Built scanner is not modified by scan() and can be shared between threads.
+    void build();
+
+    // Scans data, hits[i] receives offsets of signature i
+    void scan(const char *data, size_t size, std::vector<hits_t> & hits, engine_e engine = DefaultEngine) const;
+
+    // Name of instruction set used by default engine
+    static const char* defaultEngineName();
+
+    // Helpers for hit lists, -1 is returned if there is no such hit
+    static int firstHit(const hits_t & hits, int from = 0);
+    static int lastHit(const hits_t & hits);
+
+private:
+    enum {ALPHABET_SIZE = 256};
+
+    std::vector<std::vector<unsigned char> > signatures;
+    int minLength;
+    int maxLength;
+
+    // Trie transitions, -1 for no transition
+    std::vector<int> trie;
+    // Complete transition function, built from trie
+    std::vector<int> delta;
+    // Signatures ending in each state, including ones reachable by failure links
+    std::vector<std::vector<int> > outputs;
+    std::vector<char> terminal;
+
+    void scanAutomaton(const unsigned char *data, size_t size, std::vector<hits_t> & hits) const;
+    void scanCandidates(const unsigned char *data, size_t size, std::vector<hits_t> & hits) const;
+    void verify(const unsigned char *data, size_t size, size_t pos, std::vector<hits_t> & hits) const;
+};
+
+#endif // SCANNER_H
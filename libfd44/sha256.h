@@ -0,0 +1,43 @@
+/* sha256.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_LENGTH   32
+
+// FIPS 180-4 SHA-256, data can be added in any number of parts
+class Sha256
+{
+public:
+    Sha256();
+
+    void update(const void *data, size_t length);
+    void final(uint8_t digest[SHA256_LENGTH]);
+
+    // Hash of single buffer
+    static void hash(const void *data, size_t length, uint8_t digest[SHA256_LENGTH]);
+
+private:
+    void transform(const uint8_t *block);
+
+    uint32_t state[8];
+    uint64_t total;
+    uint8_t buffer[64];
+    size_t buffered;
+};
+
+#endif // SHA256_H
@@ -0,0 +1,97 @@
+/* volume.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#include "volume.h"
+
+static uint64_t readUint(const ByteView & image, int pos, int length)
+{
+    uint64_t value = 0;
+    for (int i = length - 1; i >= 0; i--)
+        value = value << 8 | image.at(pos + i);
+    return value;
+}
+
+static int align(int value, int alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool FirmwareVolume::isValid(const ByteView & image, int offset)
+{
+    if (offset < 0 || offset + FV_MIN_HEADER_LENGTH > image.size() || !image.matches(offset + FV_SIGNATURE_OFFSET, FV_SIGNATURE))
+        return false;
+
+    uint64_t length = readUint(image, offset + FV_LENGTH_OFFSET, 8);
+    int headerLength = (int)readUint(image, offset + FV_HEADER_LENGTH_OFFSET, 2);
+    if (headerLength < FV_MIN_HEADER_LENGTH || headerLength % 2 != 0
+        || length < (uint64_t)headerLength || length > (uint64_t)(image.size() - offset))
+        return false;
+
+    // 16-bit words of header sum to zero
+    uint16_t sum = 0;
+    for (int i = 0; i < headerLength; i += 2)
+        sum += (uint16_t)readUint(image, offset + i, 2);
+    return sum == 0;
+}
+
+void FirmwareVolume::findFiles(const ByteView & image, int offset, const ByteView & guid, std::vector<ffs_file_t> & files)
+{
+    int length = (int)readUint(image, offset + FV_LENGTH_OFFSET, 8);
+    int end = offset + length;
+    int pos = offset + (int)readUint(image, offset + FV_HEADER_LENGTH_OFFSET, 2);
+
+    // Extended header goes before the first file, its size is not covered
+    // by header checksum, so volume with corrupted one is not walked
+    int extHeader = (int)readUint(image, offset + FV_EXT_HEADER_OFFSET_OFFSET, 2);
+    if (extHeader != 0 && extHeader + FV_EXT_HEADER_SIZE_OFFSET + 4 <= length)
+    {
+        uint32_t extSize = (uint32_t)readUint(image, offset + extHeader + FV_EXT_HEADER_SIZE_OFFSET, 4);
+        if (extSize < FV_EXT_HEADER_SIZE_OFFSET + 4 || extSize > (uint32_t)(length - extHeader))
+            return;
+        pos = offset + extHeader + (int)extSize;
+    }
+
+    // Files are aligned relative to volume start
+    pos = offset + align(pos - offset, FFS_ALIGNMENT);
+    while (pos + FFS_HEADER_LENGTH <= end)
+    {
+        // Free space is erased, so the rest of volume is 0xFF
+        if (image.mid(pos, FFS_HEADER_LENGTH).count('\xFF') == FFS_HEADER_LENGTH)
+            break;
+
+        int headerLength = FFS_HEADER_LENGTH;
+        uint64_t size = readUint(image, pos + FFS_SIZE_OFFSET, 3);
+        if (image.at(pos + FFS_ATTRIBUTES_OFFSET) & FFS_ATTRIB_LARGE_FILE)
+        {
+            if (pos + FFS_LARGE_HEADER_LENGTH > end)
+                break;
+            headerLength = FFS_LARGE_HEADER_LENGTH;
+            size = readUint(image, pos + FFS_EXTENDED_SIZE_OFFSET, 8);
+        }
+
+        // Corrupted size ends the walk
+        if (size < (uint64_t)headerLength || size > (uint64_t)(end - pos))
+            break;
+
+        if (image.matches(pos, guid.data(), guid.size()))
+        {
+            ffs_file_t file;
+            file.volume = offset;
+            file.offset = pos;
+            file.size = (int)size;
+            files.push_back(file);
+        }
+
+        pos = offset + align(pos + (int)size - offset, FFS_ALIGNMENT);
+    }
+}
@@ -0,0 +1,63 @@
+/* volume.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "bios.h"
+#include "byteview.h"
+
+// UEFI firmware volume header
+constexpr auto FV_SIGNATURE               = signature("_FVH");
+#define FV_SIGNATURE_OFFSET                 40
+#define FV_LENGTH_OFFSET                    32
+#define FV_HEADER_LENGTH_OFFSET             48
+#define FV_EXT_HEADER_OFFSET_OFFSET         52
+#define FV_EXT_HEADER_SIZE_OFFSET           16
+// Header up to block map, followed by at least one block entry and terminator
+#define FV_MIN_HEADER_LENGTH                72
+
+// FFS file header
+#define FFS_HEADER_LENGTH                   24
+#define FFS_LARGE_HEADER_LENGTH             32
+#define FFS_ATTRIBUTES_OFFSET               19
+#define FFS_SIZE_OFFSET                     20
+#define FFS_EXTENDED_SIZE_OFFSET            24
+#define FFS_ATTRIB_LARGE_FILE               0x01
+#define FFS_ALIGNMENT                       8
+
+// FFS file found in firmware volume
+typedef struct {
+    int volume;     // volume header offset
+    int offset;     // file header offset
+    int size;       // file size including header
+} ffs_file_t;
+
+// Firmware volume walker.
+// Files are visited by jumping from header to header using size fields,
+// so cost depends on number of files, not on volume size.
+// Compressed sections are not entered.
+class FirmwareVolume
+{
+public:
+    // Checks volume header at offset: signature, length, header length and checksum
+    static bool isValid(const ByteView & image, int offset);
+
+    // Appends all files of volume at offset with given name GUID
+    static void findFiles(const ByteView & image, int offset, const ByteView & guid, std::vector<ffs_file_t> & files);
+};
+
+#endif // VOLUME_H
@@ -0,0 +1,28 @@
+/* xxhash.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+#ifndef XXHASH_H
+#define XXHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// XXH64 non-cryptographic hash, runs at memory speed,
+// used to recognize unchanged image content
+class XxHash64
+{
+public:
+    static uint64_t hash(const void *data, size_t length, uint64_t seed = 0);
+};
+
+#endif // XXHASH_H
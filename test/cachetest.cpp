@@ -0,0 +1,204 @@
+/* cachetest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Parse cache tests.
+// Result found in cache, also after cache file is written and read back,
+// must be identical to fresh parse of the same image, and any change
+// of image content must miss. Cache written with other signature or
+// bios_t size is discarded, and image parsed with offsets of known build
+// must give the same result as full scan.
+
+#include <string.h>
+#include <vector>
+
+#include "fd44image.h"
+#include "fd44test.h"
+#include "parsecache.h"
+
+static parse_result_t parse(const QByteArray & image)
+{
+    parse_result_t result;
+    result.status = FD44Image::read(view(image), result.bios);
+    return result;
+}
+
+static bool sameResult(const parse_result_t & a, const parse_result_t & b)
+{
+    return a.status.error == b.status.error && a.status.offset == b.status.offset && !memcmp(&a.bios, &b.bios, sizeof(bios_t));
+}
+
+// Cache written to file data and read back
+static bool reload(const ParseCache & cache, ParseCache & loaded)
+{
+    std::vector<uint8_t> data;
+    cache.write(data);
+    return loaded.read(ByteView(data.data(), data.size()));
+}
+
+static void testResults()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    options.mac_type = GbE;
+    options.gbe_count = 1;
+    QByteArray image = ImageGenerator::generate(options);
+    options.seed++;
+    options.empty_module = true;
+    QByteArray empty = ImageGenerator::generate(options);
+    QByteArray junk(0x10000, '\x5A');
+
+    ParseCache cache;
+    const QByteArray *images[] = {&image, &empty, &junk};
+    for (int i = 0; i < 3; i++)
+    {
+        file_state_t state;
+        state.size = images[i]->size();
+        state.mtime = 1000 + i;
+        state.hash = ParseCache::hash(view(*images[i]));
+        cache.addResult(state.hash, parse(*images[i]));
+        cache.addFile(QString("image%1.rom").arg(i).toUtf8().constData(), state);
+    }
+
+    ParseCache loaded;
+    if (!check(reload(cache, loaded), "cache reload"))
+        return;
+
+    // Valid, empty and failed results are kept as they were parsed
+    for (int i = 0; i < 3; i++)
+    {
+        uint64_t hash;
+        parse_result_t cached;
+        std::string path = QString("image%1.rom").arg(i).toUtf8().constData();
+        check(loaded.findFile(path, images[i]->size(), 1000 + i, hash) && hash == ParseCache::hash(view(*images[i])),
+              QString("cache file %1 found").arg(i));
+        check(loaded.findResult(ParseCache::hash(view(*images[i])), cached) && sameResult(cached, parse(*images[i])),
+              QString("cache result %1 equals fresh parse").arg(i));
+        check(!loaded.findFile(path, images[i]->size() + 1, 1000 + i, hash) && !loaded.findFile(path, images[i]->size(), 999, hash),
+              QString("cache file %1 with other size or time missed").arg(i));
+    }
+
+    // Personalized image and single changed byte anywhere in image
+    bios_t bios = parse(image).bios;
+    FD44Image::setField(bios, MacField, ByteView("\x02\x11\x22\x33\x44\x55", MAC_LENGTH));
+    std::vector<image_patch_t> patches;
+    FD44Image::buildPatches(view(image), bios, patches);
+    QByteArray personalized = image;
+    FD44Image::applyPatches(personalized.data(), personalized.size(), patches);
+    parse_result_t cached;
+    check(!loaded.findResult(ParseCache::hash(view(personalized)), cached), "cache personalized image missed");
+
+    const int offsets[] = {0, 1, image.size() / 2, image.size() - 1};
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+    {
+        QByteArray changed = image;
+        changed[offsets[i]] = (char)(changed.at(offsets[i]) ^ 0x01);
+        check(!loaded.findResult(ParseCache::hash(view(changed)), cached), QString("cache image changed at 0x%1 missed").arg(offsets[i], 0, 16));
+    }
+    check(!loaded.findResult(ParseCache::hash(view(image.left(image.size() - 1))), cached), "cache truncated image missed");
+}
+
+static void testStaleCache()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    QByteArray image = ImageGenerator::generate(options);
+    uint64_t hash = ParseCache::hash(view(image));
+    image_offsets_t offsets;
+    FD44Image::scan(view(image), offsets);
+
+    ParseCache cache;
+    file_state_t state = {image.size(), 1000, hash};
+    cache.addResult(hash, parse(image));
+    cache.addFile("image.rom", state);
+    cache.addBuild(view(image), offsets);
+    std::vector<uint8_t> data;
+    cache.write(data);
+
+    // Cache of the previous record layout, record size of other build and cut record
+    std::vector<uint8_t> previous = data;
+    previous[PARSE_CACHE_SIGNATURE.size() - 1] = '1';
+    std::vector<uint8_t> otherSize = data;
+    otherSize[PARSE_CACHE_SIGNATURE.size()]--;
+    std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+    const std::vector<uint8_t> *stale[] = {&previous, &otherSize, &truncated};
+    const char *names[] = {"signature", "record size", "truncated"};
+
+    for (int i = 0; i < 3; i++)
+    {
+        // Loaded cache is filled first, stale data must leave it empty
+        ParseCache loaded;
+        reload(cache, loaded);
+        parse_result_t result;
+        image_offsets_t found;
+        uint64_t fileHash;
+        check(!loaded.read(ByteView(stale[i]->data(), stale[i]->size()))
+              && !loaded.findResult(hash, result) && !loaded.findFile("image.rom", image.size(), 1000, fileHash)
+              && !loaded.findBuild(view(image), found), QString("cache stale %1 discarded").arg(names[i]));
+    }
+}
+
+static void testBuilds()
+{
+    for (int layout = 0; layout < LayoutCount; layout++)
+    {
+        generator_options_t options = ImageGenerator::defaultOptions();
+        options.size = 1024 * 1024;
+        options.layout = (layout_e)layout;
+        options.me = Me3M;
+        options.mac_type = GbE;
+        options.gbe_count = 2;
+        options.volume = (layout % 2 != 0);
+        if (!ImageGenerator::validate(options).isEmpty())
+            continue;
+        QString name = QString("cache build %1").arg(ImageGenerator::layoutName(options.layout));
+
+        QByteArray first = ImageGenerator::generate(options);
+        image_offsets_t offsets;
+        FD44Image::scan(view(first), offsets);
+        ParseCache cache, loaded;
+        cache.addBuild(view(first), offsets);
+        if (!check(reload(cache, loaded), name + " reload"))
+            continue;
+
+        // Other board of the same build is parsed with its offsets
+        options.seed += 1000;
+        QByteArray second = ImageGenerator::generate(options);
+        image_offsets_t found;
+        if (!check(loaded.findBuild(view(second), found), name + " found"))
+            continue;
+        parse_result_t indexed;
+        indexed.status = FD44Image::read(view(second), found, indexed.bios);
+        check(indexed.status.error == NoError && sameResult(indexed, parse(second))
+              && compareExpected(indexed.bios, options).isEmpty(), name + " result equals full scan");
+
+        // Changed module header and other BIOS version are other builds
+        QByteArray changed = second;
+        int module = found.modules.front();
+        changed[module] = (char)(changed.at(module) ^ 0x01);
+        check(!loaded.findBuild(view(changed), found), name + " changed module header missed");
+
+        QByteArray version = second;
+        int key = offsets.bootefi.back() + BUILD_KEY_OFFSET;
+        version[key] = (char)(version.at(key) ^ 0x01);
+        check(!loaded.findBuild(view(version), found), name + " other version missed");
+        check(!loaded.findBuild(view(second.left(second.size() - 0x1000)), found), name + " other size missed");
+    }
+}
+
+void testParseCache()
+{
+    testResults();
+    testStaleCache();
+    testBuilds();
+}
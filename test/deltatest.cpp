@@ -0,0 +1,190 @@
+/* deltatest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Delta file tests.
+// Delta of personalized generated image is written, read back and applied
+// to base image, result must parse with new values. Images that are not
+// delta base and truncated or corrupted delta files must be rejected.
+
+#include <string.h>
+#include <vector>
+
+#include "delta.h"
+#include "fd44image.h"
+#include "fd44test.h"
+
+#define NEW_MAC "\x02\x11\x22\x33\x44\x55"
+
+static QByteArray toByteArray(const std::vector<uint8_t> & data)
+{
+    return QByteArray((const char*)data.data(), (int)data.size());
+}
+
+static void putUint32(QByteArray & data, int pos, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        data[pos + i] = (char)(value >> (8 * i));
+}
+
+static bool readDelta(const QByteArray & data)
+{
+    image_delta_t delta;
+    return ImageDelta::read(view(data), delta);
+}
+
+static void testRoundTrip(const generator_options_t & options, const QString & name)
+{
+    QByteArray base = ImageGenerator::generate(options);
+    bios_t bios;
+    if (!check(FD44Image::read(view(base), bios).error == NoError, name + " read base"))
+        return;
+
+    FD44Image::setField(bios, MacField, ByteView(NEW_MAC, MAC_LENGTH));
+    std::vector<image_patch_t> patches;
+    if (!check(FD44Image::buildPatches(view(base), bios, patches).error == NoError && !patches.empty(), name + " patches"))
+        return;
+
+    image_delta_t delta, readBack;
+    std::vector<uint8_t> data;
+    ImageDelta::build(view(base), patches, delta);
+    ImageDelta::write(delta, data);
+    QByteArray file = toByteArray(data);
+    if (!check(ImageDelta::read(view(file), readBack), name + " read delta"))
+        return;
+    check(readBack.base_size == delta.base_size && readBack.entries.size() == delta.entries.size()
+          && !memcmp(readBack.base_hash, delta.base_hash, SHA256_LENGTH)
+          && !memcmp(readBack.result_hash, delta.result_hash, SHA256_LENGTH), name + " delta header");
+
+    // Applied delta gives the same image as patches
+    QByteArray patched = base, result = base;
+    FD44Image::applyPatches(patched.data(), patched.size(), patches);
+    std::vector<image_patch_t> deltaPatches;
+    ImageDelta::toPatches(readBack, deltaPatches);
+    FD44Image::applyPatches(result.data(), result.size(), deltaPatches);
+    check(result == patched, name + " applied delta equals patched image");
+
+    check(ImageDelta::match(view(base), readBack) == DeltaBase, name + " base matches");
+    check(ImageDelta::match(view(result), readBack) == DeltaResult, name + " result matches");
+    bios_t resultBios;
+    check(FD44Image::read(view(result), resultBios).error == NoError
+          && ImageDelta::firstChangedEntry(view(base), readBack) == -1
+          && !memcmp(FD44Image::field(resultBios, MacField).data(), NEW_MAC, MAC_LENGTH), name + " result MAC");
+
+    // Image of other board, changed byte in replaced range and outside of it, other size
+    generator_options_t otherOptions = options;
+    otherOptions.seed++;
+    QByteArray other = ImageGenerator::generate(otherOptions);
+    check(ImageDelta::match(view(other), readBack) == DeltaMismatch, name + " other image mismatch");
+
+    QByteArray changed = base;
+    changed[readBack.entries.back().offset] = (char)~changed.at(readBack.entries.back().offset);
+    check(ImageDelta::match(view(changed), readBack) == DeltaMismatch
+          && ImageDelta::firstChangedEntry(view(changed), readBack) == (int)readBack.entries.size() - 1, name + " changed entry mismatch");
+
+    changed = base;
+    changed[0] = (char)~changed.at(0);
+    check(ImageDelta::match(view(changed), readBack) == DeltaMismatch
+          && ImageDelta::firstChangedEntry(view(changed), readBack) == -1, name + " changed byte outside of entries mismatch");
+
+    check(ImageDelta::match(view(base.left(base.size() - 1)), readBack) == DeltaMismatch, name + " truncated image mismatch");
+}
+
+static void testCorruptDelta()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    options.gbe_count = 2;
+    options.mac_type = GbE;
+    QByteArray base = ImageGenerator::generate(options);
+    bios_t bios;
+    FD44Image::read(view(base), bios);
+    FD44Image::setField(bios, MacField, ByteView(NEW_MAC, MAC_LENGTH));
+    std::vector<image_patch_t> patches;
+    FD44Image::buildPatches(view(base), bios, patches);
+    image_delta_t delta;
+    std::vector<uint8_t> data;
+    ImageDelta::build(view(base), patches, delta);
+    ImageDelta::write(delta, data);
+    const QByteArray file = toByteArray(data);
+    if (!check(readDelta(file) && delta.entries.size() >= 2, "delta corrupt base"))
+        return;
+
+    // Every truncated file and file with extra bytes
+    QString failed;
+    for (int length = 0; length < file.size(); length++)
+    {
+        if (readDelta(file.left(length)))
+            failed += QString(" %1").arg(length);
+    }
+    check(failed.isEmpty(), "delta truncated at" + failed);
+    check(!readDelta(file + QByteArray(1, 0)), "delta trailing byte");
+
+    QByteArray corrupt = file;
+    corrupt[0] = 'X';
+    check(!readDelta(corrupt), "delta signature");
+
+    const int countOffset = DELTA_SIGNATURE.size() + 4 + 2 * SHA256_LENGTH;
+    const int firstEntry = DELTA_HEADER_LENGTH;
+    const int secondEntry = firstEntry + DELTA_ENTRY_HEADER_LENGTH + (int)delta.entries[0].data.size();
+    const uint32_t baseSize = (uint32_t)base.size();
+    const uint32_t firstLength = (uint32_t)delta.entries[0].data.size();
+
+    // Base size, entry count, entry offset and length
+    const struct {
+        int pos;
+        uint32_t value;
+        const char *name;
+    } fields[] = {
+        {DELTA_SIGNATURE.size(), 0x80000000, "negative base size"},
+        {DELTA_SIGNATURE.size(), (uint32_t)delta.entries.back().offset, "base size before last entry"},
+        {countOffset, (uint32_t)delta.entries.size() + 1, "entry count too large"},
+        {countOffset, 0xFFFFFFFF, "entry count overflow"},
+        {firstEntry, baseSize, "entry at base end"},
+        {firstEntry, 0xFFFFFFFF, "entry offset overflow"},
+        {firstEntry + 4, 0xFFFFFFFF, "entry length overflow"},
+        {firstEntry + 4, firstLength + 1, "entry length past next entry"},
+        {secondEntry, (uint32_t)delta.entries[0].offset, "overlapping entries"},
+        {secondEntry, 0, "unsorted entries"},
+        {secondEntry, baseSize - 1, "entry past base end"},
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        corrupt = file;
+        putUint32(corrupt, fields[i].pos, fields[i].value);
+        check(!readDelta(corrupt), QString("delta %1").arg(fields[i].name));
+    }
+
+    // Corrupted hash is read, but no image matches it
+    corrupt = file;
+    corrupt[DELTA_SIGNATURE.size() + 4] = (char)~corrupt.at(DELTA_SIGNATURE.size() + 4);
+    image_delta_t corruptDelta;
+    check(ImageDelta::read(view(corrupt), corruptDelta) && ImageDelta::match(view(base), corruptDelta) == DeltaMismatch, "delta base hash");
+}
+
+void testDelta()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    testRoundTrip(options, "delta ascii");
+
+    options.mac_type = GbE;
+    options.gbe_count = 2;
+    testRoundTrip(options, "delta gbe");
+
+    options.volume = true;
+    options.module_count = 2;
+    testRoundTrip(options, "delta volume");
+
+    testCorruptDelta();
+}
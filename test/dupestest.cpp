@@ -0,0 +1,202 @@
+/* dupestest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Duplicate index tests.
+// Fleet of boards with unique values is indexed with planted MAC, UUID
+// and MBSN duplicates. Only planted duplicates must be found: values
+// passing Bloom filter without being indexed, equal bytes of other fields
+// and boards sharing UUID part before MAC are not duplicates.
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "dupindex.h"
+#include "bloomfilter.h"
+#include "fd44image.h"
+#include "fd44test.h"
+#include "xxhash.h"
+
+#define FLEET_SIZE          1000
+#define MBSN_LENGTH         (MBSN_BODY_LENGTH - 1)
+
+static quint32 nextRandom(quint32 & state)
+{
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+// Board of parsed template with unique values derived from number
+static bios_t board(const bios_t & base, uint32_t number)
+{
+    bios_t bios = base;
+    quint32 state = number * 7919 + 1;
+    char mac[MAC_LENGTH], uuid[UUID_LENGTH - MAC_LENGTH], mbsn[MBSN_LENGTH];
+    mac[0] = 0x02;
+    for (int i = 1; i < MAC_LENGTH; i++)
+        mac[i] = (char)(i < 3 ? nextRandom(state) : number >> (8 * (MAC_LENGTH - 1 - i)));
+    for (int i = 0; i < UUID_LENGTH - MAC_LENGTH; i++)
+        uuid[i] = (char)nextRandom(state);
+    for (int i = 0; i < MBSN_LENGTH; i++)
+        mbsn[i] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[(i < 8 ? nextRandom(state) : number >> (4 * (MBSN_LENGTH - 1 - i))) % (i < 8 ? 36 : 16)];
+
+    FD44Image::setField(bios, MacField, ByteView(mac, MAC_LENGTH));
+    FD44Image::setField(bios, UuidField, ByteView(uuid, UUID_LENGTH - MAC_LENGTH));
+    FD44Image::setField(bios, MbsnField, ByteView(mbsn, MBSN_LENGTH));
+    return bios;
+}
+
+static void copyField(bios_t & bios, const bios_t & from, bios_field_e field)
+{
+    ByteView value = FD44Image::field(from, field);
+    std::vector<char> copy(value.data(), value.data() + value.size());
+    FD44Image::setField(bios, field, ByteView(copy.data(), (int)copy.size()));
+}
+
+// Same hash as index uses for Bloom filter
+static uint64_t valueHash(const duplicate_entry_t & entry)
+{
+    return XxHash64::hash(entry.value, DUPLICATE_VALUE_LENGTH, entry.field);
+}
+
+static int findCount(const DuplicateIndex & index, const duplicate_entry_t & entry)
+{
+    std::vector<duplicate_entry_t> found;
+    index.find(entry, found);
+    return (int)found.size();
+}
+
+// Index entries of batch entry, as paths
+static std::vector<std::string> findPaths(const DuplicateIndex & index, const duplicate_entry_t & entry)
+{
+    std::vector<duplicate_entry_t> found;
+    index.find(entry, found);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < found.size(); i++)
+        paths.push_back(index.path(found[i].path));
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static std::string boardPath(uint32_t number)
+{
+    return QString("board%1.rom").arg(number).toUtf8().constData();
+}
+
+void testDuplicates()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    options.mac_type = GbE;
+    options.gbe_count = 1;
+    QByteArray image = ImageGenerator::generate(options);
+    bios_t base;
+    if (!check(FD44Image::read(view(image), base).error == NoError, "dupes template"))
+        return;
+
+    // Every board has its own values, except planted duplicates:
+    // board 1 has MAC of board 0, board 3 has MBSN of board 2,
+    // board 5 has UUID and MAC of board 4, board 7 has only UUID part of board 6
+    std::vector<bios_t> boards;
+    for (uint32_t i = 0; i < FLEET_SIZE; i++)
+        boards.push_back(board(base, i));
+    copyField(boards[1], boards[0], MacField);
+    copyField(boards[3], boards[2], MbsnField);
+    copyField(boards[5], boards[4], UuidField);
+    copyField(boards[5], boards[4], MacField);
+    copyField(boards[7], boards[6], UuidField);
+
+    std::vector<duplicate_entry_t> entries;
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < FLEET_SIZE; i++)
+    {
+        DuplicateIndex::entries(boards[i], i, entries);
+        paths.push_back(boardPath(i));
+    }
+    check(entries.size() == FLEET_SIZE * DuplicateFieldCount, "dupes entries of every board");
+
+    std::vector<uint8_t> data;
+    DuplicateIndex::write(DuplicateIndex(), entries, paths, data);
+    DuplicateIndex index;
+    if (!check(index.open(ByteView(data.data(), data.size())) && index.entryCount() == entries.size()
+               && index.pathCount() == FLEET_SIZE, "dupes index open"))
+        return;
+
+    // Every indexed value is found with exactly the planted boards
+    QString failed;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const duplicate_entry_t & entry = entries[i];
+        std::vector<std::string> expected(1, boardPath(entry.path));
+        uint32_t twin = entry.path ^ 1;
+        if ((entry.field == DuplicateMac && (entry.path <= 1 || entry.path == 4 || entry.path == 5))
+            || (entry.field == DuplicateMbsn && (entry.path == 2 || entry.path == 3))
+            || (entry.field == DuplicateUuid && (entry.path == 4 || entry.path == 5)))
+            expected.push_back(boardPath(twin));
+        std::sort(expected.begin(), expected.end());
+        if (findPaths(index, entry) != expected)
+            failed += QString(" %1/%2").arg(entry.path).arg(entry.field);
+    }
+    check(failed.isEmpty(), "dupes found with other boards" + failed);
+
+    // Boards 6 and 7 share UUID part before MAC only
+    std::vector<duplicate_entry_t> uuid;
+    DuplicateIndex::entries(boards[7], 7, uuid);
+    check(uuid.size() == DuplicateFieldCount && uuid[DuplicateUuid].field == DuplicateUuid
+          && findCount(index, uuid[DuplicateUuid]) == 1, "dupes UUID with other MAC part is unique");
+
+    // Values of other boards that pass Bloom filter are not found
+    int candidates = 0;
+    failed.clear();
+    ByteView bloom(data.data() + DUPLICATE_INDEX_HEADER_LENGTH, (int)BloomFilter::size(entries.size()));
+    for (uint32_t i = FLEET_SIZE; i < 20 * FLEET_SIZE; i++)
+    {
+        std::vector<duplicate_entry_t> other;
+        DuplicateIndex::entries(board(base, i), i, other);
+        for (size_t j = 0; j < other.size(); j++)
+        {
+            if (!BloomFilter::mightContain(bloom, valueHash(other[j])))
+                continue;
+            candidates++;
+            if (findCount(index, other[j]) != 0)
+                failed += QString(" %1/%2").arg(i).arg(j);
+        }
+    }
+    check(candidates > 0, "dupes Bloom filter false positive candidates");
+    check(failed.isEmpty(), "dupes false positive reported" + failed);
+
+    // MAC bytes stored as MBSN value are other value
+    duplicate_entry_t crossed = entries[0];
+    crossed.field = DuplicateMbsn;
+    check(findCount(index, crossed) == 0, "dupes equal bytes of other field");
+
+    // Blank values are not indexed
+    bios_t blank = board(base, 0);
+    FD44Image::setField(blank, MacField, ByteView("\xFF\xFF\xFF\xFF\xFF\xFF", MAC_LENGTH));
+    FD44Image::setField(blank, UuidField, ByteView("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", UUID_LENGTH - MAC_LENGTH));
+    std::vector<duplicate_entry_t> blankEntries;
+    DuplicateIndex::entries(blank, 0, blankEntries);
+    check(blankEntries.size() == 2 && blankEntries[0].field == DuplicateUuid && blankEntries[1].field == DuplicateMbsn,
+          "dupes blank MAC skipped");
+
+    // Board checked again replaces its own entries instead of duplicating them
+    std::vector<duplicate_entry_t> again;
+    DuplicateIndex::entries(boards[10], 0, again);
+    std::vector<uint8_t> updated;
+    DuplicateIndex::write(index, again, std::vector<std::string>(1, boardPath(10)), updated);
+    DuplicateIndex updatedIndex;
+    check(updatedIndex.open(ByteView(updated.data(), updated.size())) && updatedIndex.entryCount() == entries.size()
+          && updatedIndex.pathCount() == FLEET_SIZE && findCount(updatedIndex, again[DuplicateMac]) == 1, "dupes board indexed again");
+}
@@ -0,0 +1,215 @@
+/* fd44test.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Parser tests on synthetic images.
+// Parses images of every module layout, MAC storage and ME type, compares
+// parsed fields with values written by generator and fails if parsing
+// allocates more than a few times per image: fields are read through byte
+// views and copied into bios_t only, scan results are the only heap
+// allocations of full parse, and parse with known signature offsets
+// must not allocate at all.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include <QByteArray>
+#include <QTextStream>
+
+#include "common.h"
+#include "fd44image.h"
+#include "fd44test.h"
+#include "scanner.h"
+
+// Four offset lists of scan result and their growth
+#define MAX_READ_ALLOCATIONS        8
+#define MAX_INDEXED_ALLOCATIONS     0
+
+// Counts C++ heap allocations, libfd44 allocates through operator new only
+static unsigned long long allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+// Used by standard algorithms for temporary buffers
+void* operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    allocationCount++;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t & tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    operator delete[](p);
+}
+
+static int tests = 0;
+static int failed = 0;
+
+bool check(bool condition, const QString & name)
+{
+    tests++;
+    if (!condition)
+    {
+        failed++;
+        QTextStream(stdout) << "FAIL " << name << "\n";
+    }
+    return condition;
+}
+
+QString compareExpected(const bios_t & bios, const generator_options_t & options)
+{
+    QStringList keys = recordKeys();
+    QStringList values = recordValues(bios, QString());
+    QStringList expectedKeys = ImageGenerator::expectedKeys();
+    QStringList expectedValues = ImageGenerator::expectedValues(options);
+
+    // Values generator leaves empty are taken from board database
+    for (int i = 0; i < expectedKeys.size(); i++)
+    {
+        int key = keys.indexOf(expectedKeys.at(i));
+        if (!expectedValues.at(i).isEmpty() && (key == -1 || values.at(key) != expectedValues.at(i)))
+            return expectedKeys.at(i);
+    }
+    return QString();
+}
+
+void testParser()
+{
+    generator_options_t base = ImageGenerator::defaultOptions();
+    base.size = 2 * 1024 * 1024;
+    base.decoys_per_mb = 50;
+
+    // Static tables are built by the first parse
+    {
+        QByteArray image = ImageGenerator::generate(base);
+        bios_t bios;
+        FD44Image::read(view(image), bios);
+    }
+
+    int count = 0;
+    for (int layout = 0; layout < LayoutCount; layout++)
+    {
+        for (int mac = UUID; mac <= GbE; mac++)
+        {
+            for (int me = NoMe; me <= Me5M; me++)
+            {
+                generator_options_t options = base;
+                options.layout = (layout_e)layout;
+                options.mac_type = (mac_e)mac;
+                options.gbe_count = (mac == GbE) ? 1 : 0;
+                options.me = (generator_me_e)me;
+                options.volume = (me % 2 != 0);
+                options.seed = base.seed + count++;
+                if (!ImageGenerator::validate(options).isEmpty())
+                    continue;
+
+                QByteArray image = ImageGenerator::generate(options);
+                bios_t bios, indexedBios;
+                image_offsets_t offsets;
+                FD44Image::scan(view(image), offsets);
+
+                unsigned long long before = allocationCount;
+                image_status_t status = FD44Image::read(view(image), bios);
+                unsigned long long read = allocationCount - before;
+
+                before = allocationCount;
+                image_status_t indexedStatus = FD44Image::read(view(image), offsets, indexedBios);
+                unsigned long long indexed = allocationCount - before;
+
+                QString name = QString("parser layout=%1 mac=%2 me=%3").arg(ImageGenerator::layoutName(options.layout)).arg(mac).arg(me);
+                check(status.error == NoError && indexedStatus.error == NoError, name + " error");
+                QString field = compareExpected(bios, options);
+                check(field.isEmpty(), name + " field " + field);
+                field = compareExpected(indexedBios, options);
+                check(field.isEmpty(), name + " indexed field " + field);
+                check(read <= MAX_READ_ALLOCATIONS, QString("%1 read_allocs=%2").arg(name).arg(read));
+                check(indexed <= MAX_INDEXED_ALLOCATIONS, QString("%1 indexed_allocs=%2").arg(name).arg(indexed));
+
+                // MAC type of UUID images comes from board database and may need GbE that generator leaves out
+                patch_layout_t layout;
+                int expected = (bios.mac_type == GbE && options.gbe_count == 0) ? OutputGbeNotFound : NoError;
+                check(FD44Image::buildLayout(view(image), offsets, bios, layout).error == expected, name + " layout");
+            }
+        }
+    }
+
+    // Output image with other motherboard name, also with loaded name as its prefix
+    {
+        QByteArray image = ImageGenerator::generate(base);
+        bios_t bios;
+        image_offsets_t offsets;
+        FD44Image::read(view(image), bios);
+        FD44Image::scan(view(image), offsets);
+        int pos = SignatureScanner::lastHit(offsets.bootefi) + BOOTEFI_HEADER.size() + BOOTEFI_MAGIC_LENGTH + BOOTEFI_BIOS_VERSION_LENGTH;
+        int length = FD44Image::field(bios, MotherboardNameField).size();
+
+        QByteArray other = image;
+        other[pos] = (char)(other.at(pos) ^ 0x20);
+        QByteArray longer = image;
+        longer[pos + length] = 'X';
+        const QByteArray outputs[] = {other, longer};
+        for (int i = 0; i < 2; i++)
+        {
+            patch_layout_t layout;
+            image_status_t status = FD44Image::buildLayout(view(outputs[i]), offsets, bios, layout);
+            check(status.error == OutputMotherboardDiffers && status.offset == pos, QString("parser other motherboard %1").arg(i));
+        }
+    }
+}
+
+int main()
+{
+    testParser();
+    testVolumes();
+    testMePartitionTable();
+    testScanner();
+    testDelta();
+    testParseCache();
+    testDuplicates();
+
+    QTextStream(stdout) << "tests=" << tests << " failed=" << failed << "\n";
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+/* fd44test.h
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+#ifndef FD44TEST_H
+#define FD44TEST_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "byteview.h"
+#include "imagegenerator.h"
+
+// Counts check and prints name of failed one, returns condition
+bool check(bool condition, const QString & name);
+
+inline ByteView view(const QByteArray & data)
+{
+    return ByteView(data.constData(), data.size());
+}
+
+// Compares parsed fields with values written by generator,
+// returns name of first differing field or empty string
+QString compareExpected(const bios_t & bios, const generator_options_t & options);
+
+// Test groups
+void testParser();
+void testVolumes();
+void testMePartitionTable();
+void testScanner();
+void testDelta();
+void testParseCache();
+void testDuplicates();
+
+#endif // FD44TEST_H
@@ -0,0 +1,23 @@
+QT       = core
+
+TARGET = fd44test
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+INCLUDEPATH += ../cli
+
+SOURCES += fd44test.cpp \
+    cachetest.cpp \
+    deltatest.cpp \
+    dupestest.cpp \
+    metest.cpp \
+    scannertest.cpp \
+    volumetest.cpp \
+    ../cli/common.cpp
+
+HEADERS += fd44test.h
+
+include(../fd44core.pri)
+include(../gen/imagegenerator.pri)
@@ -0,0 +1,84 @@
+/* metest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// ME partition table tests.
+// Partition offsets are relative to ME region start given by flash descriptor,
+// $FPT tables outside of that region are not ME firmware.
+
+#include <string.h>
+
+#include "fd44image.h"
+#include "fd44test.h"
+#include "mefpt.h"
+
+// Generated ME region has $FPT after ROM bypass vector at its start
+#define GENERATED_ME_OFFSET         0x1000
+#define GENERATED_ME_END            0x6000
+#define GENERATED_FPT_OFFSET        (GENERATED_ME_OFFSET + ME_FPT_ROMB_LENGTH)
+#define GENERATED_FPT_LENGTH        (ME_FPT_MIN_HEADER_LENGTH + 4 * ME_FPT_ENTRY_LENGTH)
+
+static bool readMatches(const QByteArray & image, const image_offsets_t & offsets, const generator_options_t & options)
+{
+    bios_t bios;
+    image_status_t status = FD44Image::read(view(image), offsets, bios);
+    return status.error == NoError && compareExpected(bios, options).isEmpty();
+}
+
+void testMePartitionTable()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    options.descriptor = true;
+    options.me = Me5M;
+    QByteArray image = ImageGenerator::generate(options);
+    int header = GENERATED_FPT_OFFSET - ME_HEADER.size() + ME_FPT_SIGNATURE_LENGTH;
+
+    image_offsets_t offsets;
+    FD44Image::scan(view(image), offsets);
+    check(readMatches(image, offsets, options), "me descriptor image");
+
+    // Longer padding before $FPT, partitions are still found from region start
+    {
+        QByteArray copy = image;
+        int length = ME_HEADER.size() - ME_FPT_SIGNATURE_LENGTH + GENERATED_FPT_LENGTH;
+        memmove(copy.data() + header + 0x10, copy.constData() + header, length);
+        memset(copy.data() + header, 0, 0x10);
+        image_offsets_t moved;
+        FD44Image::scan(view(copy), moved);
+        check(moved.me.size() == 1 && moved.me[0] == header + 0x10, "me moved table found");
+        check(readMatches(copy, moved, options), "me moved table read");
+    }
+
+    // Copy of table in descriptor region lists smaller firmware and must be skipped
+    {
+        QByteArray copy = image;
+        int stray = 0x800;
+        int length = ME_HEADER.size() - ME_FPT_SIGNATURE_LENGTH + GENERATED_FPT_LENGTH;
+        memcpy(copy.data() + stray, copy.constData() + header, length);
+        int table = stray + ME_HEADER.size() - ME_FPT_SIGNATURE_LENGTH;
+        int entry = table + ME_FPT_MIN_HEADER_LENGTH;
+        for (int i = 0; i < 4; i++, entry += ME_FPT_ENTRY_LENGTH)
+            if (view(copy).matches(entry, ME_5M_SIGN))
+                memcpy(copy.data() + entry, "NONE", 4);
+
+        me_firmware_t me;
+        check(MePartitionTable::read(view(copy), table, table - ME_FPT_ROMB_LENGTH, copy.size(), me) && me.type == ME_3M,
+              "me stray table without descriptor");
+        check(!MePartitionTable::read(view(copy), table, GENERATED_ME_OFFSET, GENERATED_ME_END, me), "me stray table outside region");
+
+        image_offsets_t stale = offsets;
+        stale.me.insert(stale.me.begin(), stray);
+        check(readMatches(copy, stale, options), "me stray table read");
+    }
+}
@@ -0,0 +1,177 @@
+/* scannertest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Signature scanner tests.
+// Default engine, SIMD candidate filter on targets supporting it,
+// and Aho-Corasick automaton must both find exactly the hits of a plain
+// byte-by-byte search, also for signatures straddling SIMD blocks
+// and ending in the last bytes of data.
+
+#include <string.h>
+#include <vector>
+
+#include "bios.h"
+#include "fd44test.h"
+#include "scanner.h"
+#include "volume.h"
+
+// Covers two AVX2 blocks plus longest signature
+#define SMALL_BUFFER_MAX_SIZE       96
+// Image end is tested on its last bytes only
+#define IMAGE_TAIL_LENGTH           0x1000
+
+typedef std::vector<std::vector<char> > signatures_t;
+
+static void addSignature(signatures_t & signatures, const char *data, int length)
+{
+    signatures.push_back(std::vector<char>(data, data + length));
+}
+
+template <size_t N> static void addSignature(signatures_t & signatures, const std::array<uint8_t, N> & signature)
+{
+    addSignature(signatures, (const char*)signature.data(), N);
+}
+
+static void referenceScan(const signatures_t & signatures, const QByteArray & data, std::vector<hits_t> & hits)
+{
+    hits.assign(signatures.size(), hits_t());
+    for (int pos = 0; pos < data.size(); pos++)
+    {
+        for (size_t i = 0; i < signatures.size(); i++)
+        {
+            int length = (int)signatures[i].size();
+            if (pos + length <= data.size() && !memcmp(data.constData() + pos, &signatures[i][0], length))
+                hits[i].push_back(pos);
+        }
+    }
+}
+
+// Returns empty string if both engines find reference hits
+static QString compareEngines(const SignatureScanner & scanner, const signatures_t & signatures, const QByteArray & data)
+{
+    std::vector<hits_t> expected, found, automaton;
+    referenceScan(signatures, data, expected);
+    scanner.scan(data.constData(), data.size(), found);
+    scanner.scan(data.constData(), data.size(), automaton, SignatureScanner::AutomatonEngine);
+    if (found != expected)
+        return SignatureScanner::defaultEngineName();
+    if (automaton != expected)
+        return "automaton";
+    return QString();
+}
+
+static quint32 nextRandom(quint32 & state)
+{
+    state = state * 1103515245 + 12345;
+    return state >> 8;
+}
+
+static void testSignatures(const QString & name, const signatures_t & signatures)
+{
+    SignatureScanner scanner;
+    for (size_t i = 0; i < signatures.size(); i++)
+        scanner.addSignature(&signatures[i][0], (int)signatures[i].size());
+    scanner.build();
+
+    // Every signature at every position of small buffers of every size,
+    // filled with random bytes and with first and last signature bytes
+    quint32 state = 1;
+    for (int size = 0; size <= SMALL_BUFFER_MAX_SIZE; size++)
+    {
+        QString failed;
+        for (size_t i = 0; i < signatures.size() && failed.isEmpty(); i++)
+        {
+            const std::vector<char> & signature = signatures[i];
+            int length = (int)signature.size();
+            for (int fill = 0; fill < 3 && failed.isEmpty(); fill++)
+            {
+                for (int pos = 0; pos + length <= size && failed.isEmpty(); pos++)
+                {
+                    QByteArray data(size, 0);
+                    for (int j = 0; j < size; j++)
+                        data[j] = fill == 0 ? (char)nextRandom(state) : fill == 1 ? signature.front() : signature.back();
+                    memcpy(data.data() + pos, &signature[0], length);
+                    QString engine = compareEngines(scanner, signatures, data);
+                    if (!engine.isEmpty())
+                        failed = QString("%1 signature=%2 fill=%3 pos=%4").arg(engine).arg(i).arg(fill).arg(pos);
+                }
+            }
+        }
+        check(failed.isEmpty(), QString("scanner %1 size=%2 %3").arg(name).arg(size).arg(failed));
+    }
+
+    // Generated image with decoys, every signature planted across SIMD block
+    // boundaries, at odd offsets and at the very end
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 512 * 1024;
+    options.decoys_per_mb = 400;
+    QByteArray image = ImageGenerator::generate(options);
+    int pos = 0x10000;
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        const std::vector<char> & signature = signatures[i];
+        int length = (int)signature.size();
+        const int offsets[] = {32 - length / 2, 16 - length + 1, 31, 33, 7};
+        for (size_t j = 0; j < sizeof(offsets) / sizeof(offsets[0]); j++, pos += 0x100)
+            memcpy(image.data() + pos + offsets[j], &signature[0], length);
+    }
+    QString engine = compareEngines(scanner, signatures, image);
+    check(engine.isEmpty(), QString("scanner %1 image %2").arg(name).arg(engine));
+
+    for (size_t i = 0; i < signatures.size(); i++)
+    {
+        const std::vector<char> & signature = signatures[i];
+        int length = (int)signature.size();
+        for (int end = 0; end < 3; end++)
+        {
+            QByteArray copy = image.right(IMAGE_TAIL_LENGTH);
+            memcpy(copy.data() + copy.size() - length - end, &signature[0], length);
+            engine = compareEngines(scanner, signatures, copy);
+            check(engine.isEmpty(), QString("scanner %1 signature=%2 at %3 bytes from end %4").arg(name).arg(i).arg(end).arg(engine));
+        }
+    }
+}
+
+void testScanner()
+{
+    // Signatures of image scan
+    signatures_t image;
+    addSignature(image, BOOTEFI_HEADER);
+    addSignature(image, ME_HEADER);
+    addSignature(image, GBE_HEADER);
+    addSignature(image, MODULE_HEADER);
+    addSignature(image, FV_SIGNATURE);
+    testSignatures("image", image);
+
+    // Largest set compared by SIMD engines, with shared prefixes and suffixes
+    signatures_t module = image;
+    addSignature(module, ME_3M_SIGN);
+    addSignature(module, ME_5M_SIGN);
+    addSignature(module, GBE_MAC_STUB);
+    addSignature(module, ASCII_MAC_HEADER_6_SERIES);
+    addSignature(module, ASCII_MAC_HEADER_7_SERIES);
+    addSignature(module, DTS_SHORT_HEADER_6_SERIES);
+    addSignature(module, DTS_LONG_HEADER_6_SERIES);
+    addSignature(module, DTS_LONG_PART2);
+    addSignature(module, UUID_HEADER_7_SERIES);
+    addSignature(module, MBSN_HEADER_X79);
+    addSignature(module, "\xFF\xFF", 2);
+    testSignatures("module", module);
+
+    // More signatures than SIMD engines compare, automaton is used by both
+    signatures_t all = module;
+    addSignature(all, MBSN_HEADER_6_SERIES);
+    addSignature(all, UUID_HEADER_X79);
+    testSignatures("all", all);
+}
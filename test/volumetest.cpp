@@ -0,0 +1,101 @@
+/* volumetest.cpp
+
+  Copyright (c) 2012, Nikolaj Schlej. All rights reserved.
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+*/
+
+
+// Firmware volume walker tests.
+// Extended header size is outside of checksummed volume header,
+// so any value of it must end the walk inside volume bounds.
+
+#include <vector>
+
+#include "fd44image.h"
+#include "fd44test.h"
+#include "volume.h"
+
+// Extended header is placed in pad file body, which is 0xFF in generated images
+#define EXT_HEADER_OFFSET           (0x48 + FFS_HEADER_LENGTH)
+
+static void putUint(QByteArray & image, int pos, uint32_t value, int length)
+{
+    for (int i = 0; i < length; i++)
+        image[pos + i] = (char)(value >> (8 * i));
+}
+
+// Sets extended header offset and fixes header checksum
+static void setExtHeader(QByteArray & image, int volume, int offset, uint32_t size)
+{
+    putUint(image, volume + FV_EXT_HEADER_OFFSET_OFFSET, offset, 2);
+    putUint(image, volume + offset + FV_EXT_HEADER_SIZE_OFFSET, size, 4);
+
+    putUint(image, volume + 50, 0, 2);
+    int headerLength = (uchar)image.at(volume + FV_HEADER_LENGTH_OFFSET) | (uchar)image.at(volume + FV_HEADER_LENGTH_OFFSET + 1) << 8;
+    uint16_t sum = 0;
+    for (int i = 0; i < headerLength; i += 2)
+        sum += (uint16_t)((uchar)image.at(volume + i) | (uchar)image.at(volume + i + 1) << 8);
+    putUint(image, volume + 50, (uint16_t)(0x10000 - sum), 2);
+}
+
+void testVolumes()
+{
+    generator_options_t options = ImageGenerator::defaultOptions();
+    options.size = 1024 * 1024;
+    options.volume = true;
+    options.module_count = 2;
+    QByteArray image = ImageGenerator::generate(options);
+    int volume = image.size() / 2;
+
+    image_offsets_t offsets;
+    FD44Image::scan(view(image), offsets);
+    if (!check(offsets.modules.size() == 2, "volume modules found"))
+        return;
+    int volumeLength = (uchar)image.at(volume + FV_LENGTH_OFFSET) | (uchar)image.at(volume + FV_LENGTH_OFFSET + 1) << 8
+                       | (uchar)image.at(volume + FV_LENGTH_OFFSET + 2) << 16;
+
+    // Valid extended header ending at first module
+    {
+        QByteArray copy = image;
+        setExtHeader(copy, volume, EXT_HEADER_OFFSET, offsets.modules[0] - volume - EXT_HEADER_OFFSET);
+        std::vector<ffs_file_t> files;
+        check(FirmwareVolume::isValid(view(copy), volume), "volume valid extended header checksum");
+        FirmwareVolume::findFiles(view(copy), volume, MODULE_HEADER, files);
+        check(files.size() == 2 && files[0].offset == offsets.modules[0], "volume valid extended header files");
+    }
+
+    // Sizes that are negative as int, smaller than extended header or past volume end
+    const uint32_t sizes[] = {0, 3, FV_EXT_HEADER_SIZE_OFFSET + 3, 0x7FFFFFFF, 0x80000000, 0xFFFFFFF0, 0xFFFFFFFF,
+                              (uint32_t)(volumeLength - EXT_HEADER_OFFSET + 1), (uint32_t)(image.size() - volume)};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        QByteArray copy = image;
+        setExtHeader(copy, volume, EXT_HEADER_OFFSET, sizes[i]);
+        QString name = QString("volume extended header size 0x%1").arg(sizes[i], 0, 16);
+
+        std::vector<ffs_file_t> files;
+        FirmwareVolume::findFiles(view(copy), volume, MODULE_HEADER, files);
+        check(files.empty(), name + " files");
+
+        // Modules are still found by signature
+        bios_t bios;
+        image_status_t status = FD44Image::read(view(copy), bios);
+        check(status.error == NoError && compareExpected(bios, options).isEmpty(), name + " read");
+    }
+
+    // Extended header offset past volume end
+    {
+        QByteArray copy = image;
+        setExtHeader(copy, volume, 0xFFF0, 0x20);
+        bios_t bios;
+        image_status_t status = FD44Image::read(view(copy), bios);
+        check(status.error == NoError && compareExpected(bios, options).isEmpty(), "volume extended header offset past end");
+    }
+}